@@ -6,23 +6,175 @@
 #include "mesh.hpp"
 #include "material.hpp"
 #include "material_builder.hpp"
+#include "thread_pool.hpp"
+#include "texture_streamer.hpp"
+#include "texture_array.hpp"
+#include "file_watcher.hpp"
+#include "asset_registry.hpp"
 
 #include <vector>
 #include <memory>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <map>
+#include <utility>
+
+struct MeshMemoryStats {
+    std::string name;
+    size_t cpu_bytes;
+    size_t gpu_bytes;
+};
 
 class AssetManager {
 private:
-    std::vector<std::shared_ptr<Shader>> shaders;
-    std::vector<std::shared_ptr<Texture>> textures;
-    std::vector<std::shared_ptr<Mesh>> meshes;
-    std::vector<std::shared_ptr<Material>> materials;
+    struct LoadedMesh {
+        std::shared_ptr<Mesh> target;
+        std::unique_ptr<Mesh> data;
+        std::string path;
+        bool success;
+    };
+
+    struct DecodedTexture {
+        std::weak_ptr<Texture> target;
+        std::weak_ptr<TextureLayer> layer; // set instead of target for packed textures
+        TextureImage image;
+        CompressedImage compressed;
+        bool is_compressed;
+        bool is_streamed;
+        std::string path;
+        std::string cooked_path;
+        bool success;
+    };
+
+    // Shaders are keyed by directory, textures by path and color space
+    // (sampling lives in SamplerCache, so one texture serves every sampler),
+    // meshes by path. Materials have no key.
+    AssetRegistry<Shader> shaders;
+    AssetRegistry<Texture> textures;
+    AssetRegistry<Mesh> meshes;
+    AssetRegistry<Material> materials;
+
+    // Unloaded assets, kept alive for a few frames (see collect_garbage).
+    struct RetiredAsset {
+        std::shared_ptr<void> asset;
+        uint64_t frame;
+    };
+    std::deque<RetiredAsset> retired_assets;
+    uint64_t frame = 0;
+    bool unload_requested = false;
+    size_t retire_unused();
+
+    // Keyed by source hash, so directories with identical GLSL share a program.
+    std::unordered_map<uint64_t, std::weak_ptr<Shader>> shader_cache;
+    size_t texture_decode_count = 0;
+
+    // Images decoded on a worker, waiting for their GL upload on the main thread.
+    std::mutex decoded_textures_mutex;
+    std::deque<DecodedTexture> decoded_textures;
+    std::atomic<size_t> textures_in_flight = 0;
+    TextureStreamer streamer{workers};
+
+    // Packed textures: one array per image size, small images share atlas pages.
+    std::unordered_map<std::string, std::weak_ptr<TextureLayer>> texture_layer_cache;
+    std::map<std::pair<int, int>, std::shared_ptr<TextureArray>> texture_arrays;
+    std::unique_ptr<TextureAtlas> texture_atlas;
+
+    bool pack_texture(const TextureImage &image, TextureLayer &layer);
+    void queue_texture_decode(const std::shared_ptr<Texture> &texture, const std::string &path);
+    void queue_texture_layer_decode(const std::shared_ptr<TextureLayer> &layer, const std::string &path);
+    void queue_mesh_import(const std::shared_ptr<Mesh> &mesh, const std::string &path);
+
+    // Hot reload: what was loaded from each watched file.
+    FileWatcher watcher;
+    std::unordered_map<std::string, std::vector<std::weak_ptr<Shader>>> shaders_by_file;
+    std::unordered_map<std::string, std::vector<std::weak_ptr<Texture>>> textures_by_file;
+    std::unordered_map<std::string, std::vector<std::weak_ptr<Mesh>>> meshes_by_file;
+    void reload_file(const std::string &path);
+    void prune_expired();
+
+    // Meshes parsed on a worker, waiting for their GL upload on the main thread.
+    std::mutex loaded_meshes_mutex;
+    std::deque<LoadedMesh> loaded_meshes;
+    std::atomic<size_t> meshes_in_flight = 0;
+
+    // Declared last so workers are joined before the queues they write to are destroyed.
+    ThreadPool workers;
 
 public:
     AssetManager() = default;
-    std::shared_ptr<Shader> create_shader();
-    std::shared_ptr<Texture> create_texture();
+
+    // Assets that do not come from a file; they are registered without a key.
+    std::shared_ptr<Shader> create_shader(const ShaderSource &source);
+    // An empty texture, pending until the caller uploads to it.
+    std::shared_ptr<Texture> create_texture(const TextureSettings &settings = TextureSettings());
     std::shared_ptr<Mesh> create_mesh();
     MaterialBuilder create_material();
+
+    // Every loaded or created asset, for handle lookups: find(path), get(handle),
+    // and acquire/release to keep an asset loaded while nothing else uses it.
+    AssetRegistry<Shader> &get_shaders() { return shaders; }
+    AssetRegistry<Texture> &get_textures() { return textures; }
+    AssetRegistry<Mesh> &get_meshes() { return meshes; }
+    AssetRegistry<Material> &get_materials() { return materials; }
+    static std::string get_texture_key(const std::string &path, const TextureSettings &settings);
+
+    // Unloads every asset with no acquired handle that nothing outside the
+    // manager holds, e.g. after a scene change. GL objects are deleted
+    // config.asset_release_delay_frames later, since draws already queued
+    // this frame may still point at them; assets only their unloaded
+    // users held are unloaded as those go.
+    void unload_unused();
+    // Deletes unloaded assets whose delay has passed. Call once per frame.
+    void collect_garbage();
+    size_t get_retired_asset_count() const { return retired_assets.size(); }
+
+    // Returns the program built from directory/vertex.glsl and fragment.glsl,
+    // shared with every other load of the same source.
+    std::shared_ptr<Shader> load_shader(const std::string &directory);
+
+    // Returns the cached texture for this path and settings. On a miss the
+    // texture starts as a placeholder and the file is decoded on the worker pool.
+    std::shared_ptr<Texture> load_texture(const std::string &path, const TextureSettings &settings = TextureSettings());
+    size_t get_texture_decode_count() const { return texture_decode_count; }
+
+    // Uploads decoded textures until budget_bytes of pixels are sent (at least one per call),
+    // then lets the TextureStreamer move mips in and out. Call once per frame.
+    // Returns the number of textures made ready.
+    size_t process_pending_texture_uploads(size_t budget_bytes);
+    size_t get_pending_texture_count() const { return textures_in_flight; }
+
+    // Like load_texture, but packs the image into a shared TextureArray layer
+    // (or an atlas page when small) so materials using it can batch together.
+    std::shared_ptr<TextureLayer> load_texture_layer(const std::string &path);
+    const TextureStreamer &get_texture_streamer() const { return streamer; }
+
+    // Where the cooker writes the runtime version of a source asset:
+    // config.cooked_asset_dir/<source_path><extension>.
+    static std::string get_cooked_path(const std::string &source_path, const std::string &extension);
+
+    // Returns the mesh already loaded from path, or a pending mesh that
+    // fills in once Assimp import finishes on the worker pool.
+    std::shared_ptr<Mesh> load_mesh_async(const std::string &path);
+
+    // Uploads finished imports until budget_ms is spent (at least one per call).
+    // Returns the number of meshes made ready.
+    size_t process_pending_uploads(double budget_ms);
+    size_t get_pending_mesh_count() const { return meshes_in_flight; }
+
+    // Per-mesh memory for every mesh currently loaded.
+    std::vector<MeshMemoryStats> get_mesh_memory_stats() const;
+
+    // With config.hot_reload, reloads shaders, textures and meshes whose files
+    // changed. A shader that fails to compile keeps its previous program.
+    // Call once per frame, before the upload steps.
+    void process_file_changes();
+
+    // Releases GL objects owned by the manager, unloaded assets included;
+    // call while the context is alive.
+    void shutdown();
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,87 @@
+#ifndef ASSET_PACK_HPP
+#define ASSET_PACK_HPP
+
+#include "mapped_file.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The bytes of one pack entry: a view into the mapping when the entry is
+// stored as is, otherwise decompressed into storage.
+struct AssetBytes {
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    std::vector<uint8_t> storage;
+};
+
+enum class PackCompression : uint32_t { None = 0, LZ4 = 1 };
+
+// Cooked assets concatenated into one file, which is memory-mapped and
+// read in place:
+//
+//   header | entry data, each starting on a page boundary | table of contents
+//
+// The table of contents is sorted by name (a normalized relative path), so
+// lookups are a binary search. Readers are safe to use from any thread.
+//
+// read() trusts the entry's bytes: content hashes are checked once, by
+// verify(), which write_asset_pack runs on every pack it writes and mount
+// runs on request. DDS entries are never compressed, since streaming reads
+// them again for every mip range.
+class AssetPack {
+public:
+    struct Entry {
+        std::string name;
+        uint64_t offset;
+        uint64_t size;        // once decompressed
+        uint64_t stored_size; // in the pack
+        uint64_t hash;        // hash_bytes of the decompressed bytes
+        PackCompression compression;
+    };
+
+    static constexpr uint32_t version = 1;
+    static constexpr uint64_t alignment = 4096;
+
+private:
+    MappedFile file;
+    std::vector<Entry> entries;
+
+    static inline std::unique_ptr<AssetPack> mounted;
+
+public:
+    bool open(const std::string &path);
+
+    const Entry *find(const std::string &name) const;
+    bool read(const Entry &entry, AssetBytes &bytes) const;
+    // Reads every entry and compares it with its stored hash; logs each mismatch.
+    bool verify() const;
+    const std::vector<Entry> &get_entries() const { return entries; }
+
+    // "assets/../x.png" and "x.png" name the same entry.
+    static std::string normalize_name(const std::string &path);
+
+    // The pack the loaders check before opening a loose file. Mount before
+    // loading starts; it is read from worker threads without locking. With
+    // verify, a pack whose contents do not match their hashes is refused.
+    static bool mount(const std::string &path, bool verify = false);
+    static void unmount() { mounted.reset(); }
+    static const AssetPack *get_mounted() { return mounted.get(); }
+    // False when nothing is mounted or the mounted pack lacks path.
+    static bool read_mounted(const std::string &path, AssetBytes &bytes);
+    static bool contains_mounted(const std::string &path);
+};
+
+struct AssetPackInput {
+    std::string name;        // what the engine will ask for
+    std::string source_path; // where to read it from now
+};
+
+// Writes inputs into a pack at path, then verifies it. With compress, an
+// entry other than a DDS file is stored as LZ4 when that saves at least an
+// eighth of its size.
+bool write_asset_pack(const std::string &path, const std::vector<AssetPackInput> &inputs, bool compress);
+
+#endif // ASSET_PACK_HPP
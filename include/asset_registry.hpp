@@ -0,0 +1,172 @@
+#ifndef ASSET_REGISTRY_HPP
+#define ASSET_REGISTRY_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Names a registry slot. The generation changes whenever the slot's asset
+// is unloaded, so a handle kept past that resolves to null instead of to
+// whatever reuses the slot. A default handle is never valid.
+template <typename T>
+struct AssetHandle {
+    uint32_t index = 0;
+    uint32_t generation = 0;
+
+    bool is_valid() const { return generation != 0; }
+    bool operator==(const AssetHandle &) const = default;
+};
+
+// Owns every asset of one type that an AssetManager created or loaded, by
+// slot, with an optional set of lookup keys (paths) per slot.
+//
+// Assets are shared with their users as shared_ptrs. An asset is unused,
+// and can be unloaded, once no handle holds a reference (see acquire) and
+// the registry's own shared_ptr is the last one.
+template <typename T>
+class AssetRegistry {
+private:
+    struct Slot {
+        std::shared_ptr<T> asset;
+        std::vector<std::string> keys;
+        uint32_t generation = 1;
+        uint32_t ref_count = 0;
+    };
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> free_slots;
+    std::unordered_map<std::string, uint32_t> slots_by_key;
+    std::unordered_map<const T *, uint32_t> slots_by_asset;
+
+    const Slot *resolve(AssetHandle<T> handle) const {
+        if (handle.index >= slots.size()) return nullptr;
+        const Slot &slot = slots[handle.index];
+        return slot.asset && slot.generation == handle.generation ? &slot : nullptr;
+    }
+    Slot *resolve(AssetHandle<T> handle) {
+        return const_cast<Slot *>(static_cast<const AssetRegistry *>(this)->resolve(handle));
+    }
+
+public:
+    // Registers an asset, under key if one is given. An asset that is
+    // already registered gets key added as another name for its slot.
+    AssetHandle<T> add(std::shared_ptr<T> asset, const std::string &key = "") {
+        uint32_t index;
+        if (auto it = slots_by_asset.find(asset.get()); it != slots_by_asset.end()) {
+            index = it->second;
+        } else if (!free_slots.empty()) {
+            index = free_slots.back();
+            free_slots.pop_back();
+        } else {
+            index = static_cast<uint32_t>(slots.size());
+            slots.emplace_back();
+        }
+
+        Slot &slot = slots[index];
+        if (!slot.asset) {
+            slot.asset = asset;
+            slots_by_asset[asset.get()] = index;
+        }
+        if (!key.empty()) {
+            // A key moves to the newest asset loaded under it.
+            if (auto it = slots_by_key.find(key); it != slots_by_key.end() && it->second != index) {
+                std::erase(slots[it->second].keys, key);
+            }
+            if (std::find(slot.keys.begin(), slot.keys.end(), key) == slot.keys.end()) slot.keys.push_back(key);
+            slots_by_key[key] = index;
+        }
+        return {index, slot.generation};
+    }
+
+    AssetHandle<T> find(const std::string &key) const {
+        auto it = slots_by_key.find(key);
+        if (it == slots_by_key.end()) return {};
+        return {it->second, slots[it->second].generation};
+    }
+
+    AssetHandle<T> find(const T *asset) const {
+        auto it = slots_by_asset.find(asset);
+        if (it == slots_by_asset.end()) return {};
+        return {it->second, slots[it->second].generation};
+    }
+
+    // Null for invalid and stale handles.
+    std::shared_ptr<T> get(AssetHandle<T> handle) const {
+        const Slot *slot = resolve(handle);
+        return slot ? slot->asset : nullptr;
+    }
+
+    std::shared_ptr<T> get(const std::string &key) const { return get(find(key)); }
+
+    // Explicit references keep an asset loaded even while nothing else uses
+    // it, e.g. to carry it across a scene change. False for stale handles.
+    bool acquire(AssetHandle<T> handle) {
+        Slot *slot = resolve(handle);
+        if (!slot) return false;
+        slot->ref_count++;
+        return true;
+    }
+
+    bool release(AssetHandle<T> handle) {
+        Slot *slot = resolve(handle);
+        if (!slot || slot->ref_count == 0) return false;
+        slot->ref_count--;
+        return true;
+    }
+
+    uint32_t get_ref_count(AssetHandle<T> handle) const {
+        const Slot *slot = resolve(handle);
+        return slot ? slot->ref_count : 0;
+    }
+
+    // Empties the slot of every unused asset and hands the asset to retire,
+    // which decides when it is actually destroyed. Returns how many were unloaded.
+    size_t unload_unused(const std::function<void(std::shared_ptr<T>)> &retire) {
+        size_t unloaded = 0;
+        for (uint32_t index = 0; index < slots.size(); ++index) {
+            Slot &slot = slots[index];
+            if (!slot.asset || slot.ref_count > 0 || slot.asset.use_count() > 1) continue;
+
+            for (const std::string &key : slot.keys) slots_by_key.erase(key);
+            slots_by_asset.erase(slot.asset.get());
+            retire(std::move(slot.asset));
+            slot.asset = nullptr;
+            slot.keys.clear();
+            slot.generation++;
+            if (slot.generation == 0) slot.generation = 1;
+            free_slots.push_back(index);
+            unloaded++;
+        }
+        return unloaded;
+    }
+
+    // Drops every asset without waiting for it to become unused.
+    void clear() {
+        for (uint32_t index = 0; index < slots.size(); ++index) {
+            Slot &slot = slots[index];
+            if (!slot.asset) continue;
+            slot.asset = nullptr;
+            slot.keys.clear();
+            slot.generation++;
+            if (slot.generation == 0) slot.generation = 1;
+            free_slots.push_back(index);
+        }
+        slots_by_key.clear();
+        slots_by_asset.clear();
+    }
+
+    size_t get_count() const { return slots.size() - free_slots.size(); }
+
+    template <typename Function>
+    void for_each(Function function) const {
+        for (const Slot &slot : slots) {
+            if (slot.asset) function(*slot.asset);
+        }
+    }
+};
+
+#endif // ASSET_REGISTRY_HPP
@@ -3,10 +3,12 @@
 
 #include <glm/glm.hpp>
 
+#include <cfloat>
+
 class BoundingBox {
 private:
     glm::vec3 min_ = glm::vec3(FLT_MAX);
-    glm::vec3 max_ = glm::vec3(FLT_MIN);
+    glm::vec3 max_ = glm::vec3(-FLT_MAX);
 
 public:
     void grow_to_include(glm::vec3 vertex) {
@@ -14,14 +16,22 @@ public:
         min_.y = vertex.y < min_.y ? vertex.y : min_.y;
         min_.z = vertex.z < min_.z ? vertex.z : min_.z;
 
-        max_.x = vertex.x < max_.x ? vertex.x : max_.x;
-        max_.y = vertex.y < max_.y ? vertex.y : max_.y;
-        max_.z = vertex.z < max_.z ? vertex.z : max_.z;
-        
+        max_.x = vertex.x > max_.x ? vertex.x : max_.x;
+        max_.y = vertex.y > max_.y ? vertex.y : max_.y;
+        max_.z = vertex.z > max_.z ? vertex.z : max_.z;
+    }
+
+    bool is_empty() const {
+        return min_.x > max_.x;
+    }
+
+    glm::vec3 get_center() const {
+        return is_empty() ? glm::vec3(0.0f) : (min_ + max_) * 0.5f;
     }
 
-    glm::vec3 get_center() {
-        return (min_ + max_) * 0.5f;
+    // Radius of the sphere around get_center() that holds the box.
+    float get_radius() const {
+        return is_empty() ? 0.0f : glm::length(max_ - min_) * 0.5f;
     }
 
 };
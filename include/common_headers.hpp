@@ -11,6 +11,7 @@
 #include <memory>
 #include <thread>
 #include <chrono>
+#include <filesystem>
 
 #include <stb_image.h>
 
@@ -36,6 +37,14 @@
 #include "skybox.hpp"
 #include "shader.hpp"
 #include "texture.hpp"
+#include "geometry_arena.hpp"
+#include "profiler.hpp"
+#include "gpu_profiler.hpp"
+#include "render_stats.hpp"
+#include "frame_time_tracker.hpp"
+#include "gl_extensions.hpp"
+#include "render_queue.hpp"
+#include "asset_pack.hpp"
 
 #include "change_color_script.hpp"
 #include "camera_movement_script.hpp"
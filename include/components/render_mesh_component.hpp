@@ -4,6 +4,7 @@
 #include "component.hpp"
 #include "mesh.hpp"
 #include "material.hpp"
+#include "render_queue.hpp"
 
 #include <glad/glad.h>
 #include <vector>
@@ -15,12 +16,14 @@ class RenderMeshComponent : public Component {
 private: 
     std::shared_ptr<Mesh> mesh;
     std::vector<std::shared_ptr<Material>> materials;
+    std::vector<std::shared_ptr<MaterialInstance>> material_instances; // per submesh, if it uses one
     std::shared_ptr<TransformComponent> transform_component;
-    glm::mat4 cached_transform;
+    MaterialPropertyBlock properties; // this object's tint etc., applied to every submesh
 
 public:
     explicit RenderMeshComponent(std::shared_ptr<Mesh> mesh) {
         set_mesh(mesh);
+        if (mesh->is_pending()) return;
 
         BoundingBox bb = mesh->get_bounding_box();
         glm::vec3 c = bb.get_center();
@@ -31,48 +34,54 @@ public:
     void set_mesh(std::shared_ptr<Mesh> mesh) {
         this->mesh = mesh;
         materials.resize(mesh ? mesh->get_submesh_count() : 0, nullptr);
+        material_instances.resize(materials.size(), nullptr);
     }
     
     bool set_material(size_t submesh_index, std::shared_ptr<Material> material) {        
+        // The submesh count of an async mesh is unknown until it arrives.
+        if (mesh && mesh->is_pending() && submesh_index >= materials.size()) {
+            materials.resize(submesh_index + 1, nullptr);
+            material_instances.resize(submesh_index + 1, nullptr);
+        }
+
         if (submesh_index >= materials.size()) {
             std::cerr << "submesh index out of range\n";
             return false;
         }
         
         materials[submesh_index] = material;
+        material_instances[submesh_index] = nullptr;
         return true;
     }
 
-    bool render(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& camera_position, const LightProperties& light_properties) {
-        if (!mesh || !transform_component) return false;
-
-        glm::mat4 current_transform = transform_component->get_transform();
-            
-        // if (current_transform != cached_transform) {
-            for (auto &material : materials) {
-                if (material) material->set_uniform("transform", current_transform);
-            }
-            // cached_transform = current_transform;
-        // }
+    // Draws the submesh with the instance's parent material and its own parameter values.
+    bool set_material(size_t submesh_index, std::shared_ptr<MaterialInstance> instance) {
+        if (!set_material(submesh_index, instance ? instance->get_parent() : nullptr)) return false;
+        material_instances[submesh_index] = instance;
+        return true;
+    }
 
-        for (auto &material : materials) {
-            material->set_uniform("projection", projection);
-            material->set_uniform("view", view);
+    // Queues one draw per submesh that has a material; the transform travels
+    // with the draw instead of being written into the (shared) material.
+    bool enqueue(RenderQueue &render_queue) {
+        if (!mesh || !transform_component) return false;
 
-            material->set_uniform("light.ambient", light_properties.ambient);
-            material->set_uniform("light.diffuse", light_properties.diffuse);
-            material->set_uniform("light.direction", light_properties.direction);
+        // Still loading; not an error, just nothing to draw yet.
+        if (mesh->is_pending()) return true;
+        if (materials.size() < mesh->get_submesh_count()) {
+            materials.resize(mesh->get_submesh_count(), nullptr);
+            material_instances.resize(materials.size(), nullptr);
         }
 
-        bool success;
         mesh->upload_to_GPU();
-        success = mesh->bind();
-        if (!success) std::cout << "rmc: Mesh not bound!!!\n";
+        if (!mesh->is_ready()) return false;
+
+        const glm::mat4 current_transform = transform_component->get_transform();
+        const glm::mat3 &normal_matrix = transform_component->get_normal_matrix();
         for (size_t i = 0; i < mesh->get_submesh_count(); ++i) {
-            if (i < materials.size() && materials[i]) {
-                materials.at(i)->apply();
-                success = mesh->draw_submesh(i);
-                if (!success) std::cout << "Submesh " << i << " not drawn\n";
+            if (materials[i]) {
+                const uint32_t parameter_slot = material_instances[i] ? material_instances[i]->get_slot() : 0;
+                render_queue.submit(*mesh, i, *materials[i], current_transform, normal_matrix, parameter_slot, properties);
             }
         }
         return true;
@@ -80,6 +89,11 @@ public:
 
     std::vector<std::shared_ptr<Material>> get_materials() const { return materials; }
 
+    // Per-object values; unlike material parameters they never affect other objects.
+    void set_tint(const glm::vec4 &tint) { properties.tint = tint; }
+    void set_custom(const glm::vec4 &custom) { properties.custom = custom; }
+    const MaterialPropertyBlock &get_properties() const { return properties; }
+
     void start(GameObject &game_object) override {
         transform_component = game_object.get_component<TransformComponent>();
 
@@ -89,19 +103,28 @@ public:
     void draw_inspector_ui() override {
         ImGui::Text("Render Mesh");
 
-        if (mesh) {
+        if (mesh && mesh->is_pending()) {
+            ImGui::Text("Mesh: loading...");
+        } else if (mesh) {
             ImGui::Text("Mesh: %s", mesh->get_name().c_str());
         } else {
             ImGui::Text("Mesh: None");
         }
 
+        ImGui::ColorEdit4("Tint", glm::value_ptr(properties.tint));
+        ImGui::DragFloat4("Custom", glm::value_ptr(properties.custom), 0.01f);
+
         size_t i = 0;
         for (const auto& material : materials) {
             if (material) {
                 ImGui::Separator();
                 ImGui::Text("Material %zu", i);
 
-                material->draw_uniforms_gui();
+                if (material_instances[i]) {
+                    material_instances[i]->draw_uniforms_gui();
+                } else {
+                    material->draw_uniforms_gui();
+                }
             } else {
                 ImGui::Text("Material %zu: None", i);
             }
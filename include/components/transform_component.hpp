@@ -5,6 +5,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
 #include <iostream>
 
 struct TransformParams {
@@ -16,6 +17,7 @@ struct TransformParams {
 class TransformComponent : public Component {
 private:
     glm::mat4 transform_;
+    glm::mat3 normal_matrix_;
 
 public:
     glm::vec3 position;
@@ -23,7 +25,7 @@ public:
     glm::vec3 scale;
 
     TransformComponent()
-        : position(0.0f), rotation(glm::quat(glm::vec3(0.0f))), scale(1.0f) {}
+        : transform_(1.0f), normal_matrix_(1.0f), position(0.0f), rotation(glm::quat(glm::vec3(0.0f))), scale(1.0f) {}
 
     glm::vec3 get_front() const {
         return glm::mat3_cast(rotation) * glm::vec3(0.0f, 0.0f, -1.0f);
@@ -40,6 +42,11 @@ public:
     glm::mat4 get_transform() const {
         return transform_; 
     }
+
+    // Inverse transpose of the transform's upper 3x3, for normals.
+    const glm::mat3 &get_normal_matrix() const {
+        return normal_matrix_;
+    }
     
     void start(GameObject &game_object) override {}
 
@@ -48,6 +55,8 @@ public:
         transform_ = glm::translate(glm::mat4(1.0f), position) *
                     glm::mat4_cast(rotation) *
                     glm::scale(glm::mat4(1.0f), scale);
+        // Once per object here rather than once per vertex in the shaders.
+        normal_matrix_ = glm::inverseTranspose(glm::mat3(transform_));
     }
 
     void print_transform() {
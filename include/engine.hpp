@@ -13,6 +13,15 @@ private:
     GLFWwindow* window = nullptr;
     std::unique_ptr<Scene> active_scene;
     GameObject* selected_game_object = nullptr;
+    AssetManager assets;
+    RenderQueue render_queue;
+    FrameTimeTracker frame_times;
+
+    // Last whole frame of CPU zones, kept while the timeline is paused.
+    std::vector<ProfileThread> profiler_frame;
+    uint64_t profiler_frame_start = 0;
+    uint64_t profiler_frame_end = 0;
+    bool profiler_paused = false;
 
     /* initialize */
     bool create_window();
@@ -27,6 +36,10 @@ private:
     bool render_ui();
 
     void draw_properties_window();
+    void draw_frame_times();
+    void draw_render_stats();
+    void draw_gpu_pass_timings();
+    void draw_profiler_timeline();
 };
 
 #endif /* ENINE_HPP */
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define ENGINE_CONFIG_HPP
 
 #include <glad/glad.h>
+#include <cstddef>
 
 struct EngineConfig {
     GLuint screen_width = 1000;
@@ -9,6 +10,27 @@ struct EngineConfig {
     int target_fps = 120;
     bool wireframe_mode = false;
     bool debug_mode = false;
+    double mesh_upload_budget_ms = 2.0;
+    size_t texture_upload_budget_bytes = 16 * 1024 * 1024;
+    const char *cooked_asset_dir = "cooked"; // see AssetManager::get_cooked_path
+    bool texture_streaming = true;
+    int texture_stream_initial_size = 128; // largest mip loaded before a texture is seen
+    size_t texture_vram_budget_bytes = 256 * 1024 * 1024;
+    bool pack_textures = false; // presets use AssetManager::load_texture_layer
+    int atlas_page_size = 2048;
+    int atlas_max_texture_size = 512; // larger images get a TextureArray layer of their own
+    int atlas_padding = 4;
+    float max_anisotropy = 8.0f; // for samplers that do not set their own
+    bool shader_binary_cache = true; // used only when the context supports program binaries
+    const char *shader_cache_dir = "cache/shaders";
+    bool hot_reload = true; // AssetManager::process_file_changes; packed files are not watched
+    const char *asset_pack = "assets.pak"; // mounted at startup when it exists, see AssetPack
+    bool verify_asset_pack = false; // hash every entry once at mount, see AssetPack::verify
+    int asset_release_delay_frames = 3; // AssetManager::unload_unused
+    bool multi_draw_indirect = true; // used only when the context supports it
+    bool gpu_timing = true; // GpuProfiler, when the context has timer queries
+    const char *frame_time_csv_path = ""; // every frame's CPU/GPU time is written here on exit when set
+    const char *profile_trace_path = "profile_trace.json"; // Chrome trace export from the debug menu
 };
 
 extern EngineConfig config;
@@ -0,0 +1,39 @@
+#ifndef FILE_WATCHER_HPP
+#define FILE_WATCHER_HPP
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Reports watched files that changed on disk. On Linux this uses inotify on
+// each file's directory, since editors often save by replacing the file;
+// elsewhere it compares modification times every poll_interval.
+class FileWatcher {
+private:
+    // Keyed by normalized path.
+    std::unordered_map<std::string, std::filesystem::file_time_type> files;
+#ifdef __linux__
+    int inotify_fd = -1;
+    std::unordered_map<int, std::string> directories; // by watch descriptor
+#endif
+    std::chrono::steady_clock::time_point last_poll;
+    std::chrono::milliseconds poll_interval{250};
+
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher &) = delete;
+    FileWatcher &operator=(const FileWatcher &) = delete;
+
+    void watch(const std::string &path);
+    static std::string normalize(const std::string &path);
+
+    // Normalized paths of watched files written since the last call, each once.
+    // Cheap enough to call every frame.
+    std::vector<std::string> poll();
+};
+
+#endif // FILE_WATCHER_HPP
@@ -0,0 +1,68 @@
+#ifndef FRAME_TIME_TRACKER_HPP
+#define FRAME_TIME_TRACKER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Every frame's CPU and GPU time, for spotting stutters that an average
+// hides. The last history_size frames of each are kept for the graph and
+// the percentiles; with keep_all the whole run is kept for write_csv.
+class FrameTimeTracker {
+public:
+    static constexpr size_t history_size = 1024;
+
+    struct Percentiles {
+        float p50 = 0.0f;
+        float p95 = 0.0f;
+        float p99 = 0.0f;
+        float max = 0.0f;
+    };
+
+private:
+    struct Ring {
+        std::array<float, history_size> values{};
+        size_t next = 0;
+        size_t count = 0;
+
+        void push(float value);
+        std::vector<float> get_ordered() const; // oldest first
+    };
+
+    Ring cpu_ms;
+    Ring gpu_ms;
+    uint64_t frame_count = 0;
+    uint64_t hitch_count = 0;
+
+    bool keep_all = false;
+    std::vector<float> all_cpu_ms;
+    std::vector<float> all_gpu_ms; // by frame; negative until the frame's result is in
+
+    static Percentiles get_percentiles(const Ring &ring);
+
+public:
+    void set_keep_all(bool value) { keep_all = value; }
+
+    // A frame longer than budget_ms counts as a hitch. Returns the frame's index.
+    uint64_t add_cpu_frame(float ms, float budget_ms);
+    // GPU times arrive a few frames late (see GpuProfiler); frame is the
+    // index add_cpu_frame returned for that frame.
+    void add_gpu_frame(uint64_t frame, float ms);
+
+    std::vector<float> get_cpu_history() const { return cpu_ms.get_ordered(); }
+    std::vector<float> get_gpu_history() const { return gpu_ms.get_ordered(); }
+    Percentiles get_cpu_percentiles() const { return get_percentiles(cpu_ms); }
+    Percentiles get_gpu_percentiles() const { return get_percentiles(gpu_ms); }
+
+    uint64_t get_frame_count() const { return frame_count; }
+    uint64_t get_hitch_count() const { return hitch_count; }
+    void reset_hitch_count() { hitch_count = 0; }
+
+    // frame,cpu_ms,gpu_ms per line, gpu_ms empty where it never came in.
+    // Needs keep_all; false if nothing was kept or the file cannot be written.
+    bool write_csv(const std::string &path) const;
+};
+
+#endif // FRAME_TIME_TRACKER_HPP
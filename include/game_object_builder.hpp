@@ -1,6 +1,7 @@
 #pragma once 
 #include "game_object.hpp"
 #include "material.hpp"
+#include "asset_manager.hpp"
 #include "components/transform_component.hpp"
 #include "components/render_mesh_component.hpp"
 #include "components/camera_component.hpp"
@@ -40,6 +41,16 @@ public:
         return *this;
     }
 
+    // Imports the model on the asset workers; the object renders once the mesh is uploaded.
+    GameObjectBuilder &with_model_async(const std::string &model_path, AssetManager &assets) {
+        auto mesh = assets.load_mesh_async(model_path);
+
+        auto render_component = std::make_shared<RenderMeshComponent>(mesh);
+        game_object->add_component(render_component);
+
+        return *this;
+    }
+
     GameObjectBuilder &with_camera() {
         auto camera_component = std::make_shared<CameraComponent>();
         game_object->add_component(camera_component);
@@ -83,6 +94,23 @@ public:
         return *this;
     }
 
+    GameObjectBuilder &with_material(std::shared_ptr<MaterialInstance> instance, GLuint submesh_index = 0) {
+        auto render_mesh_component = game_object->get_component<RenderMeshComponent>();
+        if (!render_mesh_component) {
+            std::cerr << "GameObject " << game_object->name << ": can't add a material before it has a render mesh component\n";
+            return *this;
+        }
+
+        bool success = render_mesh_component->set_material(submesh_index, instance);
+        if (!success) {
+            std::cout << "GameObject " << game_object->name << ": unable to add material at submesh_index " << submesh_index << "\n";
+            return *this;
+        }
+
+        current_material = instance->get_parent();
+        return *this;
+    }
+
     GameObjectBuilder &with_script(const std::shared_ptr<ScriptComponent> &script) {
         game_object->add_component(script);
         return *this;
@@ -101,7 +129,6 @@ public:
 
     Async: 
         create_game_object_async
-        with_model_async
         on_complete
     */
 
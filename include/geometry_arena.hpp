@@ -0,0 +1,84 @@
+#ifndef GEOMETRY_ARENA_HPP
+#define GEOMETRY_ARENA_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "vertex_format.hpp"
+
+// A mesh's slice of an arena. Indices stay relative to the mesh's first vertex
+// and are offset at draw time through base_vertex.
+struct GeometryAllocation {
+    GLint base_vertex = 0;
+    GLuint first_index = 0;
+    GLuint vertex_count = 0;
+    GLuint index_count = 0;
+};
+
+// First-fit free list over [0, capacity) with coalescing on free.
+class RangeAllocator {
+private:
+    struct Range {
+        GLuint offset;
+        GLuint count;
+    };
+
+    std::vector<Range> free_ranges; // sorted by offset
+    GLuint capacity = 0;
+    GLuint used = 0;
+
+public:
+    bool allocate(GLuint count, GLuint &offset);
+    void free(GLuint offset, GLuint count);
+    void grow(GLuint new_capacity);
+    GLuint get_capacity() const { return capacity; }
+    GLuint get_used() const { return used; }
+};
+
+// Shared vertex and index buffers for every mesh of one vertex format, so all
+// of them draw from a single VAO.
+class GeometryArena {
+private:
+    VertexFormat format;
+    GLsizei vertex_stride;
+
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    GLuint ebo = 0;
+
+    RangeAllocator vertex_ranges;
+    RangeAllocator index_ranges;
+
+    static std::array<std::unique_ptr<GeometryArena>, static_cast<size_t>(VertexFormat::Count)> arenas;
+
+    explicit GeometryArena(VertexFormat format);
+    void create_buffers();
+    void set_vertex_attributes();
+    void grow_vertex_buffer(GLuint min_capacity);
+    void grow_index_buffer(GLuint min_capacity);
+
+public:
+    ~GeometryArena();
+
+    // get creates the arena on first use; find only returns an existing one.
+    static GeometryArena &get(VertexFormat format);
+    static GeometryArena *find(VertexFormat format);
+
+    // Releases the GL objects of every arena; call while the context is still current.
+    static void shutdown_all();
+
+    bool allocate(const void *vertex_data, GLuint vertex_count, const GLuint *index_data, GLuint index_count, GeometryAllocation &allocation);
+    void free(const GeometryAllocation &allocation);
+    void bind() const;
+
+    GLuint get_vao() const { return vao; }
+    GLsizei get_vertex_stride() const { return vertex_stride; }
+    const RangeAllocator &get_vertex_ranges() const { return vertex_ranges; }
+    const RangeAllocator &get_index_ranges() const { return index_ranges; }
+};
+
+#endif // GEOMETRY_ARENA_HPP
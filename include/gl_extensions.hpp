@@ -0,0 +1,97 @@
+#ifndef GL_EXTENSIONS_HPP
+#define GL_EXTENSIONS_HPP
+
+#include <glad/glad.h>
+
+#include <string>
+
+#include "texture_compression.hpp"
+
+// Entry points and enums newer than the GL 3.3 core profile glad was generated for.
+// Each is only used when the matching capability flag is set.
+
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
+#endif
+
+#ifndef GL_TEXTURE_MAX_ANISOTROPY
+#define GL_TEXTURE_MAX_ANISOTROPY 0x84FE
+#define GL_MAX_TEXTURE_MAX_ANISOTROPY 0x84FF
+#endif
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC_EXT)(GLuint program, GLsizei buf_size, GLsizei *length, GLenum *binary_format, void *binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC_EXT)(GLuint program, GLenum binary_format, const void *binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC_EXT)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC_EXT)(GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride);
+
+// Layout consumed by glMultiDrawElementsIndirect.
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instance_count;
+    GLuint first_index;
+    GLint base_vertex;
+    GLuint base_instance;
+};
+
+struct GLExtensions {
+    GLint major_version = 3;
+    GLint minor_version = 3;
+
+    // Core limit: offsets passed to glBindBufferRange for uniform buffers must be multiples of this.
+    GLint uniform_buffer_offset_alignment = 256;
+
+    // GL 4.3 or ARB_multi_draw_indirect + ARB_base_instance
+    bool multi_draw_indirect = false;
+    PFNGLMULTIDRAWELEMENTSINDIRECTPROC_EXT multi_draw_elements_indirect = nullptr;
+
+    // EXT_texture_compression_s3tc (BC1/BC3)
+    bool texture_compression_s3tc = false;
+
+    // GL 4.2 or ARB_texture_compression_bptc (BC7)
+    bool texture_compression_bptc = false;
+
+    // GL 4.6, ARB_ or EXT_texture_filter_anisotropic
+    bool texture_filter_anisotropic = false;
+    GLfloat max_anisotropy = 1.0f;
+
+    // GL 4.1 or ARB_get_program_binary, with at least one binary format
+    bool program_binary = false;
+    PFNGLGETPROGRAMBINARYPROC_EXT get_program_binary = nullptr;
+    PFNGLPROGRAMBINARYPROC_EXT program_binary_load = nullptr;
+    PFNGLPROGRAMPARAMETERIPROC_EXT program_parameteri = nullptr;
+
+    bool has_extension(const std::string &name) const;
+    bool is_version_at_least(GLint major, GLint minor) const;
+};
+
+extern GLExtensions gl_extensions;
+
+// Call once after gladLoadGLLoader with the same loader.
+bool load_gl_extensions(GLADloadproc load);
+
+// Whether the current context can sample the format; needs load_gl_extensions first.
+bool is_block_format_supported(BlockFormat format);
+GLenum get_gl_internal_format(BlockFormat format, bool srgb);
+
+#endif // GL_EXTENSIONS_HPP
@@ -0,0 +1,78 @@
+#ifndef GPU_PROFILER_HPP
+#define GPU_PROFILER_HPP
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+struct GpuPassTiming {
+    const char *name;
+    double last_ms = 0.0;
+    double average_ms = 0.0; // exponential, over roughly the last 30 frames
+};
+
+// GPU time per render pass from GL_TIME_ELAPSED queries (core since 3.3).
+// Results are read back only once the driver reports them available,
+// usually a few frames later, so timing never stalls the CPU. Passes run
+// one after another: beginning a pass ends the open one.
+class GpuProfiler {
+private:
+    struct PendingFrame {
+        uint64_t frame;
+        std::vector<std::pair<size_t, GLuint>> queries; // pass index, query
+    };
+
+    static bool supported;
+    static bool in_frame;
+    static bool pass_open;
+    static std::vector<GLuint> free_queries;
+    static std::deque<PendingFrame> pending_frames; // oldest first, the back one being recorded
+    static std::vector<GpuPassTiming> passes;
+    static double last_frame_ms;
+    static uint64_t completed_frames;
+    static std::vector<std::pair<uint64_t, double>> newly_completed;
+
+    static size_t get_pass_index(const char *name);
+    static void read_back();
+
+public:
+    // After gladLoadGLLoader. Leaves the profiler off when the context has
+    // no timer bits, e.g. on some software rasterizers.
+    static void initialize();
+    static bool is_supported() { return supported; }
+
+    // Around everything that is timed in a frame; no-ops while
+    // config.gpu_timing is off. frame is handed back with the frame's results.
+    static void begin_frame(uint64_t frame);
+    static void end_frame();
+
+    // name must be a string literal; passes are listed in first-use order.
+    static void begin_pass(const char *name);
+    static void end_pass();
+
+    static const std::vector<GpuPassTiming> &get_passes() { return passes; }
+    // Sum of the passes of the newest frame whose results are in.
+    static double get_last_frame_ms() { return last_frame_ms; }
+    // Bumped each time a frame's results come in.
+    static uint64_t get_completed_frame_count() { return completed_frames; }
+    // Frames (as passed to begin_frame) whose results came in during the
+    // last begin_frame, with their GPU time in ms.
+    static const std::vector<std::pair<uint64_t, double>> &get_newly_completed_frames() { return newly_completed; }
+
+    // Deletes every query; call while the context is still current.
+    static void shutdown();
+};
+
+class GpuPassScope {
+public:
+    explicit GpuPassScope(const char *name) { GpuProfiler::begin_pass(name); }
+    ~GpuPassScope() { GpuProfiler::end_pass(); }
+
+    GpuPassScope(const GpuPassScope &) = delete;
+    GpuPassScope &operator=(const GpuPassScope &) = delete;
+};
+
+#endif // GPU_PROFILER_HPP
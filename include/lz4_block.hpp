@@ -0,0 +1,16 @@
+#ifndef LZ4_BLOCK_HPP
+#define LZ4_BLOCK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The LZ4 block format (no frame header or checksums): anything that reads
+// raw LZ4 blocks can read these. The compressor is the simple greedy one,
+// fast to decode from rather than small.
+std::vector<uint8_t> lz4_compress(const uint8_t *source, size_t size);
+
+// Decodes exactly destination_size bytes; false on malformed or truncated input.
+bool lz4_decompress(const uint8_t *source, size_t source_size, uint8_t *destination, size_t destination_size);
+
+#endif // LZ4_BLOCK_HPP
@@ -0,0 +1,37 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file (mmap, or a file mapping on
+// Windows). Pages are read in by the OS as they are touched, and stay
+// shared with its file cache, so nothing is copied until a reader does.
+class MappedFile {
+private:
+    const uint8_t *bytes = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void *file_handle = nullptr;
+    void *mapping_handle = nullptr;
+#else
+    int descriptor = -1;
+#endif
+
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const std::string &path);
+    void close();
+
+    bool is_open() const { return bytes != nullptr; }
+    const uint8_t *get_data() const { return bytes; }
+    size_t get_size() const { return size; }
+};
+
+#endif // MAPPED_FILE_HPP
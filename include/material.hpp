@@ -2,7 +2,11 @@
 #define MATERIAL_HPP
 
 #include "shader.hpp"
+#include "parameter_block.hpp"
 #include "texture.hpp"
+#include "texture_array.hpp"
+#include "sampler_cache.hpp"
+#include "gl_extensions.hpp"
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -13,44 +17,122 @@
 #include <iostream>
 #include <memory>
 #include <unordered_map>
-#include <variant>
+#include <vector>
 #include <string>
+#include <atomic>
+#include <cstdint>
 
 
 enum class BlendMode { Opaque, AlphaBlend, Additive };
 enum class CullMode {None, Back, Front };
 
-using UniformValue = std::variant<float, glm::vec3, glm::mat4>;
+struct TextureUniform {
+    GLuint location;
+    std::shared_ptr<Texture> texture;
+    int unit;
+    SamplerSettings sampler;
+};
 
-struct Uniform {
+// A sampler2DArray bound to a packed texture's array. The layer and UV rect
+// are not uniforms: RenderQueue passes them per draw (see DrawData).
+struct TextureLayerUniform {
     GLuint location;
-    UniformValue value;
+    std::shared_ptr<TextureLayer> layer;
+    int unit;
+    SamplerSettings sampler;
 };
 
-struct TextureUniform {
+// A sampler the program declares and the texture unit only it uses.
+struct SamplerUnit {
     GLuint location;
-    std::shared_ptr<Texture> texture;
     int unit;
 };
 
+class MaterialInstance;
+
 class Material {
 private:
+    friend class MaterialInstance;
+
+    static inline std::atomic<uint32_t> next_id = 1;
+    uint32_t id = next_id++;
+
     std::shared_ptr<Shader> shader;
-    std::unordered_map<std::string, Uniform> uniforms;
+    uint32_t variant = 0;
+    GLuint program = 0; // shader's program for variant
+    uint32_t shader_generation = 0;
+
+    // Values of the shader's MaterialParams block, the material's own in slot
+    // 0 and its MaterialInstances' after it. upload_parameters() copies the
+    // bytes written since the last upload to parameter_buffer.
+    ParameterBlock parameters;
+    GLuint parameter_buffer = 0;
+    size_t parameter_buffer_size = 0;
+
     std::unordered_map<std::string, TextureUniform> texture_uniforms;
+    std::unordered_map<std::string, TextureLayerUniform> texture_layer_uniforms;
+    // Every declared sampler gets a unit, textures bound or not: GL rejects a
+    // draw when samplers of different types (sampler2D, sampler2DArray) share
+    // one, and unassigned samplers all default to unit 0.
+    std::unordered_map<std::string, SamplerUnit> sampler_units;
     int next_texture_unit = 0;
+    uint64_t batch_key = 0;
 
     BlendMode blend_mode = BlendMode::Opaque;
     bool depth_test = true;
     bool depth_write = true;
     CullMode cull_mode = CullMode::Back;
 
+    void assign_sampler_units();
+    int get_sampler_unit(const std::string &name);
+    void select_variant(uint32_t new_variant);
+    void adopt_layout(std::shared_ptr<const ParameterLayout> new_layout);
+    bool set_parameter(uint32_t slot, const std::string &name, GLenum type, const void *value);
+    bool reset_parameter(uint32_t slot, const std::string &name);
+    void draw_parameters_gui(uint32_t slot);
+    void resolve_locations();
+    void refresh_program();
+    void enable_texture_keyword(const std::string &name, bool enabled);
+
 public:
+    Material() = default;
+    ~Material();
+    Material(const Material &) = delete;
+    Material &operator=(const Material &) = delete;
+
     void set_shader(std::shared_ptr<Shader> shader);
+    const std::shared_ptr<Shader> &get_shader() const { return shader; }
+    GLuint get_program() const { return program; }
+    uint32_t get_id() const { return id; }
+    BlendMode get_blend_mode() const { return blend_mode; }
+    // Plain values are members of the shader's MaterialParams uniform block.
     bool set_uniform(const std::string &name, float value);
     bool set_uniform(const std::string &name, glm::vec3 value);
     bool set_uniform(const std::string &name, glm::mat4 value);
+    // Samples with the texture's default SamplerSettings unless set_sampler overrides them.
+    // Setting "normal_map" also enables the shader keyword USE_NORMAL_MAP, if declared.
     bool set_uniform(const std::string &name, std::shared_ptr<Texture> texture);
+    bool set_sampler(const std::string &name, const SamplerSettings &sampler);
+    int get_texture_unit_count() const { return next_texture_unit; }
+
+    // Only one packed texture per material, since each draw carries one layer and rect.
+    bool set_uniform(const std::string &name, std::shared_ptr<TextureLayer> layer);
+    const TextureLayer *get_texture_layer() const;
+
+    // Switches to the shader variant with keyword on or off (see Shader);
+    // false if the shader does not declare it.
+    bool set_keyword(const std::string &keyword, bool enabled);
+    uint32_t get_variant() const { return variant; }
+
+    // Equal for materials that apply() identically: same shader, render state,
+    // variant, parameter block and bound textures. Packed layers may differ, so materials
+    // that only differ in which layer they use share a key and draw together.
+    // Also switches to the new program after a shader hot reload.
+    uint64_t update_batch_key();
+    uint64_t get_batch_key() const { return batch_key; }
+
+    // Forwards an on-screen size to every texture for TextureStreamer.
+    void request_texture_resolution(float pixels);
 
     void print_all_uniforms();
     void check_uniforms();
@@ -59,9 +141,47 @@ public:
     void set_depth_test(bool enable);
     void set_depth_write(bool enable);
     void set_cull_mode(CullMode mode);
+    // Uploads the parameter bytes, instance slots included, written since the last upload.
+    void upload_parameters();
+    // Binds window 0 of the parameter block along with everything else.
     void apply();
+    // Rebinds the block to another window of slots after apply(). Each draw
+    // picks its slot within the window (see DrawData).
+    void bind_parameters(uint32_t window) const;
+    uint32_t get_parameter_window(uint32_t slot) const { return parameters.get_window(slot); }
+    uint32_t get_parameter_window_index(uint32_t slot) const { return parameters.get_window_index(slot); }
 
     void draw_uniforms_gui(); 
 };
 
+// A variant of a parent material that only changes some MaterialParams
+// values. The program, render state and textures stay the parent's, and so
+// does its batch key: instances of one parent sort together, and each draw
+// passes its slot to the shader, so up to a window of sibling instances
+// (ParameterLayout::slot_count) draw in one call. The values themselves live
+// in the parent's parameter block, so an instance is just a parent
+// reference and a slot; see ParameterBlock for what a slot costs.
+class MaterialInstance {
+private:
+    std::shared_ptr<Material> parent;
+    uint32_t slot;
+
+public:
+    explicit MaterialInstance(std::shared_ptr<Material> parent);
+    ~MaterialInstance();
+    MaterialInstance(const MaterialInstance &) = delete;
+    MaterialInstance &operator=(const MaterialInstance &) = delete;
+
+    const std::shared_ptr<Material> &get_parent() const { return parent; }
+    uint32_t get_slot() const { return slot; }
+
+    bool set_uniform(const std::string &name, float value);
+    bool set_uniform(const std::string &name, glm::vec3 value);
+    bool set_uniform(const std::string &name, glm::mat4 value);
+    // Follows the parent's value for name again.
+    bool reset_uniform(const std::string &name);
+
+    void draw_uniforms_gui();
+};
+
 #endif // MATERIAL_HPP
\ No newline at end of file
@@ -4,58 +4,93 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
 
 #include <vector>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <atomic>
+#include <cstdint>
 
 #include "bounding_box.hpp"
+#include "geometry_arena.hpp"
+#include "mesh_data.hpp"
+
+// What stays in system memory once a mesh has been uploaded.
+enum class MeshResidency {
+    KeepAll,            // full vertex and index arrays
+    ReleaseAfterUpload, // nothing but the submesh table and bounds
+    KeepPositions       // positions and indices, for picking and physics
+};
 
 class Mesh {
 private:
+    static inline std::atomic<uint32_t> next_id = 1;
+    uint32_t id = next_id++;
+
     std::string name = "DEFAULT MESH NAME";
 
-    struct Vertex {
-        glm::vec3 position;
-        glm::vec3 normal;
-        glm::vec4 tangent;
-        glm::vec2 uv0;
-        glm::vec2 uv1;
-    };
+    using Vertex = StandardVertex;
+
+public:
+    using Submesh = MeshData::Submesh;
 
-    struct Submesh {
-        GLuint index_offset;
-        GLuint index_count;
-    };
+private:
 
     std::vector<Vertex> vertices;
     std::vector<GLuint> indices;
     std::vector<Submesh> submeshes;
+    std::vector<glm::vec3> positions;
+
+    MeshResidency residency = MeshResidency::ReleaseAfterUpload;
+    BoundingBox bounding_box;
+    size_t gpu_bytes = 0;
 
-    GLuint vao = 0;
-    GLuint vbo = 0;
-    GLuint ebo = 0;
+    // Slice of the shared arena for this mesh's vertex format.
+    VertexFormat vertex_format = VertexFormat::Standard;
+    GeometryAllocation allocation;
 
     bool is_uploaded = false;
+    bool pending = false;
+
+    void release_cpu_data();
+    void take_data(MeshData &&data);
 
 public:
     Mesh();
     std::string get_name();
+    uint32_t get_id() const { return id; }
     void set_vertices(const std::vector<Vertex> &vertices);
     void set_indices(const std::vector<GLuint> &indices);
     bool add_submesh(GLuint index_offset, GLuint index_count);
     BoundingBox get_bounding_box();
+    const BoundingBox &get_uploaded_bounds() const { return bounding_box; }
     void upload_to_GPU();
     bool bind() const;
     bool draw_submesh(size_t submesh_index) const;
     size_t get_submesh_count() const { return submeshes.size(); }
+    const Submesh &get_submesh(size_t submesh_index) const { return submeshes[submesh_index]; }
+    VertexFormat get_vertex_format() const { return vertex_format; }
+    const GeometryAllocation &get_allocation() const { return allocation; }
+    bool is_ready() const { return is_uploaded; }
     ~Mesh();
 
+    void set_residency(MeshResidency policy) { residency = policy; }
+    MeshResidency get_residency() const { return residency; }
+    const std::vector<glm::vec3> &get_positions() const { return positions; }
+    const std::vector<GLuint> &get_indices() const { return indices; }
+    size_t get_cpu_bytes() const;
+    size_t get_gpu_bytes() const { return gpu_bytes; }
+
+    // See import_mesh and read_cooked_mesh.
     bool load(const std::string &path);
+    bool read_cooked(const std::string &path);
+
+    // Async loading: a pending mesh is a placeholder that draws nothing until
+    // the loaded data is adopted on the main thread.
+    void set_pending(bool is_pending) { pending = is_pending; }
+    bool is_pending() const { return pending; }
+    void adopt(Mesh &&loaded);
 };
 
 #endif // MESH_HPP
\ No newline at end of file
@@ -0,0 +1,35 @@
+#ifndef MESH_DATA_HPP
+#define MESH_DATA_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "vertex_format.hpp"
+
+// CPU-side geometry of a mesh as imported or cooked. Needs no GL context, so
+// the asset cooker builds it without the renderer; Mesh uploads it.
+struct MeshData {
+    struct Submesh {
+        uint32_t index_offset;
+        uint32_t index_count;
+    };
+
+    std::string name;
+    VertexFormat vertex_format = VertexFormat::Standard;
+    std::vector<StandardVertex> vertices;
+    std::vector<uint32_t> indices; // relative to the first vertex
+    std::vector<Submesh> submeshes;
+};
+
+// Imports through Assimp, also from the mounted AssetPack. Converts in
+// parallel on the calling worker's ThreadPool, serially on any other thread
+// (see parallel_for).
+bool import_mesh(const std::string &path, MeshData &mesh);
+
+// The cooked form of what import_mesh produces (see tools/asset_cooker), read
+// without Assimp; read_cooked_mesh also reads from the mounted AssetPack.
+bool write_cooked_mesh(const std::string &path, const MeshData &mesh);
+bool read_cooked_mesh(const std::string &path, MeshData &mesh);
+
+#endif // MESH_DATA_HPP
@@ -0,0 +1,101 @@
+#ifndef PARAMETER_BLOCK_HPP
+#define PARAMETER_BLOCK_HPP
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Offsets of the active members of one slot of a program's MaterialParams
+// uniform block (std140), read back through introspection. Shaders declare
+// the block as an array of slots, `MaterialSlot material_slots[N]`, and each
+// draw picks its slot by index; a block of plain members is a single slot.
+struct ParameterLayout {
+    struct Parameter {
+        std::string name; // without the "material_slots[0]." prefix
+        GLenum type; // GL_FLOAT, GL_FLOAT_VEC3, ...
+        GLuint offset; // within the slot
+    };
+
+    std::vector<Parameter> parameters;
+    GLuint size = 0; // std140 array stride of a slot; 0 when the program has no MaterialParams block
+    GLuint slot_count = 1; // slots the block declares, all reachable from one binding
+
+    const Parameter *find(const std::string &name) const;
+};
+
+// Bytes a std140 member of this type occupies; matrix columns are vec4-aligned.
+size_t get_parameter_size(GLenum type);
+
+// CPU copy of a material's MaterialParams values. Slot 0 holds the
+// material's own values, the following slots those of its
+// MaterialInstances. Slots are packed at the std140 array stride, so an
+// instance costs layout.size bytes (16 for the URP shader). Every
+// layout.slot_count consecutive slots form a window, the range one
+// glBindBufferRange exposes to the shader; windows start at multiples of
+// the context's uniform buffer offset alignment. The buffer holds whole
+// windows, so a material without instances still takes one (64 slots, 1 KB
+// for the URP shader).
+//
+// Needs no GL context: uploading is left to Material, which reads the data
+// and the range written since the last upload.
+class ParameterBlock {
+private:
+    std::shared_ptr<const ParameterLayout> layout = std::make_shared<ParameterLayout>();
+    std::vector<unsigned char> data;
+    size_t window_stride = 0; // bytes from one window to the next
+
+    // Per slot, a bit per layout parameter the instance overrides; the
+    // others follow slot 0. Slot 0 is the material's own and always exists,
+    // so instances are numbered from 1.
+    std::vector<uint64_t> overrides{0};
+    std::vector<uint32_t> free_slots;
+
+    // Bytes written since clear_dirty(); nothing when begin == end.
+    size_t dirty_begin = 0;
+    size_t dirty_end = 0;
+
+    void mark_dirty(size_t begin, size_t end);
+
+public:
+    static constexpr size_t max_overrides = 64; // parameters an instance can override
+
+    // Carries values, and which of them instances override, over by name when
+    // the program, and with it the layout, changes.
+    void set_layout(std::shared_ptr<const ParameterLayout> new_layout, size_t window_alignment);
+    const ParameterLayout &get_layout() const { return *layout; }
+
+    // New slots start out with slot 0's values; released slots are reused.
+    uint32_t allocate_slot();
+    void release_slot(uint32_t slot);
+    size_t get_slot_count() const { return overrides.size(); }
+
+    // Writing slot 0 also writes every slot that does not override the
+    // parameter, so a parent change rewrites (and re-uploads) all of its
+    // instances. Writing another slot marks the parameter overridden there.
+    void set(uint32_t slot, const ParameterLayout::Parameter &parameter, const void *value);
+    // Follows slot 0's value for parameter again.
+    void reset(uint32_t slot, const ParameterLayout::Parameter &parameter);
+    bool is_overridden(uint32_t slot, const ParameterLayout::Parameter &parameter) const;
+    const unsigned char *get(uint32_t slot, const ParameterLayout::Parameter &parameter) const;
+
+    uint32_t get_window(uint32_t slot) const { return slot / layout->slot_count; }
+    // Index of slot within its window, as the shader sees it.
+    uint32_t get_window_index(uint32_t slot) const { return slot % layout->slot_count; }
+    size_t get_window_offset(uint32_t window) const { return window * window_stride; }
+    size_t get_window_size() const { return static_cast<size_t>(layout->size) * layout->slot_count; }
+    size_t get_slot_offset(uint32_t slot) const {
+        return get_window_offset(get_window(slot)) + static_cast<size_t>(get_window_index(slot)) * layout->size;
+    }
+
+    const std::vector<unsigned char> &get_data() const { return data; }
+    bool is_dirty() const { return dirty_begin < dirty_end; }
+    size_t get_dirty_begin() const { return dirty_begin; }
+    size_t get_dirty_end() const { return dirty_end; }
+    void clear_dirty() { dirty_begin = dirty_end = 0; }
+};
+
+#endif // PARAMETER_BLOCK_HPP
@@ -0,0 +1,82 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A timed region of code on one thread. name must outlive the profiler
+// (a string literal); depth is how many zones enclosed it when it began.
+struct ProfileZone {
+    const char *name;
+    uint64_t start_ns;
+    uint64_t end_ns;
+    uint32_t depth;
+};
+
+struct ProfileThread {
+    uint32_t id; // stable per buffer, not the OS thread id
+    std::string name;
+    std::vector<ProfileZone> zones; // ordered by end time
+};
+
+// Scoped-zone CPU profiler. Every thread writes the zones it closes into a
+// ring buffer of its own without locking; the main thread reads them back
+// with capture(). Buffers of exited threads are reused by new ones, so
+// thread pools that come and go do not grow memory.
+class Profiler {
+public:
+    static constexpr size_t zones_per_thread = 16384;
+
+    static uint64_t now_ns(); // steady_clock
+
+    static void set_enabled(bool enabled);
+    static bool is_enabled();
+
+    // Names the calling thread's row in the timeline and the trace.
+    static void set_thread_name(const char *name);
+
+    // Called by ProfileScope; depth bookkeeping for the calling thread.
+    static uint32_t push_zone();
+    static void pop_zone(const char *name, uint64_t start_ns, uint32_t depth);
+
+    // Once per frame on the main thread; the timeline shows the last whole frame.
+    static void mark_frame();
+    static bool get_last_frame(uint64_t &start_ns, uint64_t &end_ns);
+
+    // Zones still in the ring buffers that overlap [from_ns, to_ns).
+    static std::vector<ProfileThread> capture(uint64_t from_ns = 0, uint64_t to_ns = UINT64_MAX);
+
+    // Everything still in the ring buffers, as Chrome trace event JSON
+    // (chrome://tracing, Perfetto).
+    static bool write_chrome_trace(const std::string &path);
+};
+
+class ProfileScope {
+private:
+    const char *name;
+    uint64_t start_ns = 0;
+    uint32_t depth = 0;
+    bool active;
+
+public:
+    explicit ProfileScope(const char *name) : name(name), active(Profiler::is_enabled()) {
+        if (!active) return;
+        depth = Profiler::push_zone();
+        start_ns = Profiler::now_ns();
+    }
+    ~ProfileScope() {
+        if (active) Profiler::pop_zone(name, start_ns, depth);
+    }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+// Times the rest of the enclosing block.
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+
+#endif // PROFILER_HPP
@@ -0,0 +1,107 @@
+#ifndef RENDER_QUEUE_HPP
+#define RENDER_QUEUE_HPP
+
+#include "mesh.hpp"
+#include "material.hpp"
+#include "structs.hpp"
+#include "gl_extensions.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Uniforms shared by every draw in a frame.
+struct FrameParams {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec3 camera_position;
+    LightProperties light_properties;
+};
+
+// std140 mirror of the FrameData uniform block the shaders declare; vec3s
+// are padded to vec4. Uploaded once per flush and bound at
+// Shader::frame_block_binding for every program.
+struct FrameUniforms {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec4 view_position;
+    glm::vec4 light_direction;
+    glm::vec4 light_ambient;
+    glm::vec4 light_diffuse;
+    glm::vec4 light_specular;
+};
+
+// Per-object values that travel with each draw instead of living in the
+// (shared) material, so objects that only differ in these still instance together.
+struct MaterialPropertyBlock {
+    glm::vec4 tint = glm::vec4(1.0f);   // multiplies the shaded colour and alpha
+    glm::vec4 custom = glm::vec4(0.0f); // free for shaders to interpret
+};
+
+// Per-draw data, read by the vertex shader as instanced attributes
+// (aTransform at locations 5-8, aTextureRect at 9, aDrawIndices at 10,
+// aNormalMatrix at 11-13, aTint at 14, aCustom at 15) indexed through the
+// draw's base instance.
+struct DrawData {
+    glm::mat4 transform;
+    glm::mat3 normal_matrix;
+    glm::vec4 texture_rect;
+    float texture_layer; // -1 while the material's packed texture is loading
+    float parameter_slot; // index into the bound window of material_slots, see ParameterBlock
+    glm::vec4 tint;
+    glm::vec4 custom;
+};
+
+class RenderQueue {
+private:
+    struct DrawItem {
+        uint64_t sort_key;
+        const Mesh *mesh;
+        GLuint submesh_index;
+        Material *material;
+        uint32_t parameter_slot; // see MaterialInstance
+        glm::mat4 transform;
+        glm::mat3 normal_matrix;
+        MaterialPropertyBlock properties;
+    };
+
+    std::vector<DrawItem> items;
+    std::vector<Material *> frame_materials;
+    std::vector<DrawData> draw_data;
+    std::vector<DrawElementsIndirectCommand> commands;
+
+    GLuint frame_buffer = 0;
+    GLuint draw_data_buffer = 0;
+    GLuint indirect_buffer = 0;
+
+    static uint64_t make_sort_key(const DrawItem &item, const glm::mat4 &view);
+    void prepare_materials(const FrameParams &frame);
+    static float get_screen_size(const DrawItem &item, const FrameParams &frame);
+    void create_buffers();
+    void bind_draw_data(size_t first_draw) const;
+    void draw_run_indirect(size_t begin, size_t end);
+    void draw_run_instanced(size_t begin, size_t end);
+
+public:
+    static constexpr GLuint draw_data_location = 5;
+
+    void clear() { items.clear(); }
+    // normal_matrix is the inverse transpose of transform's upper 3x3 (see TransformComponent).
+    // parameter_slot picks a MaterialInstance's values out of material's parameter block.
+    void submit(const Mesh &mesh, size_t submesh_index, Material &material, const glm::mat4 &transform, const glm::mat3 &normal_matrix,
+                uint32_t parameter_slot = 0, const MaterialPropertyBlock &properties = MaterialPropertyBlock());
+
+    // Sorts opaque items by program, material batch key and mesh and blended
+    // ones back to front, then draws each run of compatible items with as few
+    // calls as the context allows. Materials with equal batch keys share a
+    // run (see Material::get_batch_key); within a run, instances only split
+    // calls where they need another window of their parent's parameter block.
+    void flush(const FrameParams &frame);
+
+    // Deletes the GL buffers; call while the context is still current.
+    void shutdown();
+};
+
+#endif // RENDER_QUEUE_HPP
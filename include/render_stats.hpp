@@ -0,0 +1,62 @@
+#ifndef RENDER_STATS_HPP
+#define RENDER_STATS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// What a frame cost the renderer, counted where the GL calls are made.
+// Only the main thread touches these.
+struct RenderStats {
+    uint64_t draw_calls = 0;           // GL draw commands
+    uint64_t draws = 0;                // submeshes drawn, instances and multi-draw entries included
+    uint64_t triangles = 0;
+    uint64_t material_applies = 0;     // program + blend/depth/cull state, Material::apply
+    uint64_t vertex_array_binds = 0;
+    uint64_t texture_binds = 0;
+    uint64_t uniform_buffer_binds = 0; // parameter ranges and the frame block
+    uint64_t uniform_uploads = 0;
+    uint64_t uniform_upload_bytes = 0;
+    uint64_t buffer_upload_bytes = 0;  // geometry, per-draw data and indirect commands
+    uint64_t texture_upload_bytes = 0;
+
+    struct Field {
+        const char *name;
+        uint64_t RenderStats::*value;
+    };
+    static const std::array<Field, 11> fields;
+};
+
+// Counters for the frame being recorded.
+extern RenderStats render_stats;
+
+// The last frame_count frames of RenderStats, for the debug menu and for
+// benchmarks that compare a change before and after.
+class RenderStatsHistory {
+public:
+    static constexpr size_t frame_count = 120;
+
+    struct Summary {
+        uint64_t min = 0;
+        double average = 0.0;
+        uint64_t max = 0;
+    };
+
+private:
+    std::array<RenderStats, frame_count> frames{};
+    size_t next = 0;
+    size_t count = 0;
+
+public:
+    // Records render_stats as a finished frame and zeroes it for the next.
+    void end_frame();
+
+    size_t get_frame_count() const { return count; }
+    // The newest finished frame; all zero before the first.
+    const RenderStats &get_last_frame() const;
+    Summary summarize(uint64_t RenderStats::*value) const;
+};
+
+extern RenderStatsHistory render_stats_history;
+
+#endif // RENDER_STATS_HPP
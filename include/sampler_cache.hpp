@@ -0,0 +1,36 @@
+#ifndef SAMPLER_CACHE_HPP
+#define SAMPLER_CACHE_HPP
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Sampling state, kept apart from the texture so one texture can be read
+// with different filtering and any number of textures share one sampler.
+struct SamplerSettings {
+    GLint min_filter = GL_LINEAR_MIPMAP_LINEAR; // trilinear
+    GLint mag_filter = GL_LINEAR;
+    GLint wrap = GL_REPEAT;
+    float anisotropy = 0.0f; // 0 follows config.max_anisotropy, 1 disables it
+
+    bool operator==(const SamplerSettings &) const = default;
+};
+
+// GL sampler objects, one per distinct SamplerSettings.
+class SamplerCache {
+private:
+    static std::vector<std::pair<SamplerSettings, GLuint>> samplers;
+
+public:
+    // Returns the sampler for settings, creating it on first use. Anisotropy
+    // is resolved against config and clamped to what the context supports.
+    static GLuint get(const SamplerSettings &settings);
+    static size_t get_sampler_count() { return samplers.size(); }
+
+    // Deletes every sampler; call while the context is still current.
+    static void shutdown();
+};
+
+#endif // SAMPLER_CACHE_HPP
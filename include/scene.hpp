@@ -6,6 +6,7 @@
 #include "game_object.hpp"
 #include "game_object_builder.hpp"
 #include "components/camera_component.hpp"
+#include "profiler.hpp"
 
 class Scene {
 private:
@@ -99,6 +100,7 @@ public:
     }
 
     void update(float delta_time) {
+        PROFILE_SCOPE("Scene::update");
         for (auto &game_object : game_objects_) {
             game_object->update(delta_time);
         }
@@ -1,6 +1,8 @@
 #ifndef SHADER_HPP
 #define SHADER_HPP
 
+#include "parameter_block.hpp"
+
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
@@ -8,18 +10,86 @@
 #include <fstream> 
 #include <sstream>
 #include <iostream>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+
+// GLSL for one program, as read from disk.
+struct ShaderSource {
+    std::string vertex;
+    std::string fragment;
+    std::string vertex_path; // where read() found the stages, for reloading
+    std::string fragment_path;
+
+    bool read(const std::string &vertex_path, const std::string &fragment_path);
+    // Reads directory/vertex.glsl and directory/fragment.glsl.
+    bool read(const std::string &directory);
+    uint64_t get_hash() const; // of the code only
+};
 
+// A shader declares its keywords with `#pragma keywords USE_A USE_B ...` in
+// either stage. Each combination is a variant: a separate program compiled on
+// first use with the enabled keywords #defined. A variant is identified by a
+// bitmask over the keywords in declaration order; variant 0 has none enabled.
 class Shader {
 private:
-    GLuint program = 0;
-    
-    bool load(const std::string &vertex_path, const std::string &fragment_path);
+    ShaderSource source;
+    uint64_t source_hash = 0;
+    std::vector<std::string> keywords;
+
+    struct Variant {
+        GLuint program;
+        uint64_t program_hash; // its reference in the shared program table
+        std::shared_ptr<const ParameterLayout> layout;
+    };
+    std::unordered_map<uint32_t, Variant> variants;
+    GLuint program = 0; // variant 0
+    uint32_t generation = 0;
+
+    void init();
+    void release_variants();
 
 public:
+    // Uniform block binding points, assigned to every program at link time.
+    static constexpr GLuint frame_block_binding = 0;    // "FrameData", see RenderQueue
+    static constexpr GLuint material_block_binding = 1; // "MaterialParams", see Material
+
     Shader(const std::string &directory);
     Shader(const std::string &vertex_path, const std::string &fragment_path);
+    explicit Shader(const ShaderSource &source);
+    ~Shader();
+
+    Shader(const Shader &) = delete;
+    Shader &operator=(const Shader &) = delete;
+    Shader(Shader &&other) noexcept;
+    Shader &operator=(Shader &&other) noexcept;
+
+    // Deletes every program still linked, for shaders that outlive the
+    // context; call while it is still current.
+    static void shutdown();
+
     GLuint get_program() const  { return program; };
+    // Builds the variant on first use; 0 if it fails to compile.
+    GLuint get_program(uint32_t variant);
+    // Never null; empty if the variant has no MaterialParams block or failed to build.
+    std::shared_ptr<const ParameterLayout> get_layout(uint32_t variant);
+    uint64_t get_source_hash() const { return source_hash; }
+    const ShaderSource &get_source() const { return source; }
+
+    // Swaps in new source if variant 0 builds from it, else keeps the current
+    // programs and returns false. Other variants rebuild on their next use;
+    // a keyword's bit may change meaning if the keyword list is edited.
+    bool reload(const ShaderSource &new_source);
+    // Bumped by every successful reload; Material compares it to re-resolve its uniforms.
+    uint32_t get_generation() const { return generation; }
+
+    const std::vector<std::string> &get_keywords() const { return keywords; }
+    // Bit index of keyword in a variant mask, or -1 if the shader does not declare it.
+    int get_keyword_index(const std::string &keyword) const;
+    size_t get_variant_count() const { return variants.size(); }
+
     void use() const;
 };
 
-#endif // SHADER_HPP
\ No newline at end of file
+#endif // SHADER_HPP
@@ -4,51 +4,201 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <string>
+#include <memory>
 #include <stdexcept>
 #include <stb_image.h>
 
+#include "texture_compression.hpp"
+#include "gl_extensions.hpp"
+#include "sampler_cache.hpp"
+#include "asset_pack.hpp"
+#include "render_stats.hpp"
+
+enum class ColorSpace { Linear, SRGB };
+
+// What a texture shows until its pixels arrive: white leaves colours
+// untinted, a flat normal (0.5, 0.5, 1) leaves normal maps unbumped.
+enum class TexturePlaceholder { White, FlatNormal };
+
+struct TextureSettings {
+    // Default sampling for materials using this texture; not part of the GL texture.
+    SamplerSettings sampler;
+    ColorSpace color_space = ColorSpace::Linear;
+    TexturePlaceholder placeholder = TexturePlaceholder::White; // not part of the key
+
+    // Only what changes the GL texture a file turns into.
+    std::string get_key() const {
+        return color_space == ColorSpace::SRGB ? "srgb" : "linear";
+    }
+};
+
+// Pixels decoded by stb_image, safe to produce on any thread.
+struct TextureImage {
+    std::unique_ptr<unsigned char, void (*)(void *)> pixels{nullptr, stbi_image_free};
+    int width = 0, height = 0, channels = 0;
+
+    // desired_channels of 0 keeps the file's channel count. Decodes straight
+    // from the mounted AssetPack's mapping when it has the file.
+    bool decode(const std::string &path, int desired_channels = 0) {
+        AssetBytes packed;
+        if (AssetPack::read_mounted(path, packed)) {
+            pixels.reset(stbi_load_from_memory(packed.data, static_cast<int>(packed.size), &width, &height, &channels, desired_channels));
+        } else {
+            pixels.reset(stbi_load(path.c_str(), &width, &height, &channels, desired_channels));
+        }
+        if (desired_channels) channels = desired_channels;
+        return pixels != nullptr;
+    }
+
+    size_t get_size() const { return static_cast<size_t>(width) * height * channels; }
+};
+
 class Texture {
 private:
     GLuint id;
-    int width, height, channels;
+    int width = 1, height = 1, channels = 4;
+    TextureSettings settings;
+    bool pending = false;
+
+    // Finest mip on the GPU and how many the full chain has; set by uploads.
+    int resident_level = 0;
+    int mip_count = 1;
+    size_t gpu_bytes = 4;
+
+    // Largest on-screen size, in pixels, asked for since the streamer last looked.
+    float requested_resolution = 0.0f;
+
+    void create(const TextureSettings &texture_settings) {
+        settings = texture_settings;
+
+        // Filtering and wrapping come from the sampler bound next to it (SamplerCache).
+        glGenTextures(1, &id);
+        glBindTexture(GL_TEXTURE_2D, id);
+    }
 
 public:
-    Texture(const std::string &path) {
-        unsigned char *data = stbi_load(path.c_str(), &width, &height, &channels, 0);
-        if (!data) {
+    // Placeholder: a single texel (see TexturePlaceholder) until upload() replaces it.
+    explicit Texture(const TextureSettings &settings = TextureSettings()) : pending(true) {
+        create(settings);
+
+        const unsigned char white[4] = {255, 255, 255, 255};
+        const unsigned char flat_normal[4] = {128, 128, 255, 255};
+        const bool is_normal = settings.placeholder == TexturePlaceholder::FlatNormal;
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, is_normal ? flat_normal : white);
+        // Complete under a mipmapping sampler without a mip chain.
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    }
+
+    // Synchronous load, decodes on the calling thread.
+    Texture(const std::string &path, const TextureSettings &settings = TextureSettings()) {
+        TextureImage image;
+        if (!image.decode(path)) {
             throw std::runtime_error("Failed to load texture from " + path);
         }
 
-        glGenTextures(1, &id);
-        glBindTexture(GL_TEXTURE_2D, id);
+        create(settings);
+        upload(image);
+    }
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    ~Texture() {
+        glDeleteTextures(1, &id);
+    }
 
-        GLenum format;
+    // Respecifies the texture with decoded pixels, keeping the same id so
+    // materials holding this texture pick it up without rebinding. Reads
+    // straight from the decoded image: staging through a pixel buffer on the
+    // same thread would only add a copy.
+    void upload(const TextureImage &image) {
+        width = image.width;
+        height = image.height;
+        channels = image.channels;
+
+        GLenum format = GL_RGBA;
         if (channels == 1)
             format = GL_RED;
+        else if (channels == 2)
+            format = GL_RG;
         else if (channels == 3)
             format = GL_RGB;
-        else if (channels == 4)
-            format = GL_RGBA;
 
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        GLint internal_format = format;
+        if (settings.color_space == ColorSpace::SRGB && channels == 3)
+            internal_format = GL_SRGB8;
+        else if (settings.color_space == ColorSpace::SRGB && channels == 4)
+            internal_format = GL_SRGB8_ALPHA8;
+
+        glBindTexture(GL_TEXTURE_2D, id);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, format, GL_UNSIGNED_BYTE, image.pixels.get());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
         glGenerateMipmap(GL_TEXTURE_2D);
-            
-        stbi_image_free(data);
+
+        render_stats.texture_upload_bytes += image.get_size();
+        resident_level = 0;
+        mip_count = 1;
+        gpu_bytes = image.get_size() * 4 / 3;
+        pending = false;
     }
 
-    ~Texture() {
+    // Same as above for a cooked image: every mip level comes precompressed,
+    // so nothing is generated at runtime. The image may be a partial chain;
+    // uploading mips just finer than the resident ones extends the texture
+    // in place (see TextureStreamer), anything else should follow reset_storage().
+    void upload(const CompressedImage &image) {
+        width = image.get_width();
+        height = image.get_height();
+        channels = image.format == BlockFormat::BC5 ? 2 : 4;
+
+        const GLenum internal_format = get_gl_internal_format(image.format, settings.color_space == ColorSpace::SRGB);
+        glBindTexture(GL_TEXTURE_2D, id);
+        for (size_t i = 0; i < image.levels.size(); ++i) {
+            const auto &info = image.levels[i];
+            glCompressedTexImage2D(GL_TEXTURE_2D, image.first_level + GLint(i), internal_format, info.width, info.height, 0,
+                                   GLsizei(info.size), image.data.data() + info.offset);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, image.first_level);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.mip_count - 1);
+
+        render_stats.texture_upload_bytes += image.get_size();
+        if (image.has_last_level()) gpu_bytes = 0;
+        gpu_bytes += image.get_size();
+        resident_level = image.first_level;
+        mip_count = image.mip_count;
+        pending = false;
+    }
+
+    // Swaps in a fresh, empty GL texture so dropped mips actually free memory.
+    // Materials bind by Texture, not by id, so they follow along.
+    void reset_storage() {
         glDeleteTextures(1, &id);
+        create(settings);
+        gpu_bytes = 0;
+    }
+
+    void request_resolution(float pixels) {
+        if (pixels > requested_resolution) requested_resolution = pixels;
+    }
+
+    float take_requested_resolution() {
+        float pixels = requested_resolution;
+        requested_resolution = 0.0f;
+        return pixels;
     }
 
     void bind(GLenum unit = GL_TEXTURE0) const {
         glActiveTexture(unit);
         glBindTexture(GL_TEXTURE_2D, id);
     }
+
+    const TextureSettings &get_settings() const { return settings; }
+    bool is_pending() const { return pending; }
+    int get_width() const { return width; }
+    int get_height() const { return height; }
+    int get_resident_level() const { return resident_level; }
+    int get_mip_count() const { return mip_count; }
+    size_t get_gpu_bytes() const { return gpu_bytes; }
 };
 
 #endif // TEXTURE_HPP
\ No newline at end of file
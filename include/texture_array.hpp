@@ -0,0 +1,81 @@
+#ifndef TEXTURE_ARRAY_HPP
+#define TEXTURE_ARRAY_HPP
+
+#include "texture.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+// RGBA8 GL_TEXTURE_2D_ARRAY whose layers all share one size. Grows by
+// doubling its layer count, copying existing layers on the GPU.
+class TextureArray {
+private:
+    GLuint id = 0;
+    int width, height;
+    int layer_capacity = 0;
+    int layer_count = 0;
+    TextureSettings settings;
+
+    void allocate(int capacity);
+
+public:
+    TextureArray(int width, int height, const TextureSettings &settings = TextureSettings(), int initial_capacity = 4);
+    ~TextureArray();
+
+    TextureArray(const TextureArray &) = delete;
+    TextureArray &operator=(const TextureArray &) = delete;
+
+    // Returns the index of a new, uninitialized layer.
+    int add_layer();
+
+    // Writes RGBA8 pixels into a rectangle of a layer.
+    void write(int layer, int x, int y, int region_width, int region_height, const unsigned char *rgba);
+    void generate_mipmaps();
+
+    void bind(GLenum unit = GL_TEXTURE0) const;
+    int get_width() const { return width; }
+    int get_height() const { return height; }
+    int get_layer_count() const { return layer_count; }
+    size_t get_gpu_bytes() const { return static_cast<size_t>(width) * height * 4 * layer_capacity * 4 / 3; }
+};
+
+// Where a packed texture ended up. Materials reference this instead of a
+// Texture; rect maps the mesh's [0,1] UVs into the packed region (xy offset, zw scale).
+struct TextureLayer {
+    std::shared_ptr<TextureArray> array; // null until the image is uploaded
+    int layer = 0;
+    glm::vec4 rect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+
+    bool is_ready() const { return array != nullptr; }
+};
+
+// Packs small images into square pages, each page a layer of one TextureArray,
+// filling each page shelf by shelf.
+class TextureAtlas {
+private:
+    struct Shelf {
+        int y;
+        int height;
+        int x;
+    };
+
+    std::shared_ptr<TextureArray> pages;
+    std::vector<std::vector<Shelf>> shelves; // per page
+    int page_size;
+    int padding;
+
+    bool place(int page, int width, int height, int &x, int &y);
+
+public:
+    TextureAtlas(int page_size, int padding, const TextureSettings &settings = TextureSettings());
+
+    // Copies an RGBA8 image into the atlas and fills out layer; false if it cannot fit on a page.
+    bool add(const TextureImage &image, TextureLayer &layer);
+
+    const std::shared_ptr<TextureArray> &get_pages() const { return pages; }
+};
+
+#endif // TEXTURE_ARRAY_HPP
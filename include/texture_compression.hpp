@@ -0,0 +1,60 @@
+#ifndef TEXTURE_COMPRESSION_HPP
+#define TEXTURE_COMPRESSION_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// What a texture is used for; decides the block format it is cooked to.
+enum class TextureRole {
+    BaseMap,   // BC1, or BC3 when the image has alpha
+    NormalMap, // BC5, two channels; shaders rebuild z
+    Mask,      // BC7, for packed channels that do not correlate
+};
+
+enum class BlockFormat { BC1, BC3, BC5, BC7 };
+
+// A block-compressed image as stored in a cooked .dds. It may hold only part
+// of the mip chain: levels[i] is mip first_level + i.
+struct CompressedImage {
+    struct Level {
+        int width;
+        int height;
+        size_t offset;
+        size_t size;
+    };
+
+    BlockFormat format = BlockFormat::BC1;
+    int width = 0, height = 0; // of mip 0, loaded or not
+    int mip_count = 0;
+    int first_level = 0;
+    std::vector<Level> levels;
+    std::vector<uint8_t> data;
+
+    int get_width() const { return width; }
+    int get_height() const { return height; }
+    size_t get_size() const { return data.size(); }
+    bool has_last_level() const { return first_level + static_cast<int>(levels.size()) == mip_count; }
+};
+
+BlockFormat choose_block_format(TextureRole role, bool has_alpha);
+size_t get_block_size(BlockFormat format);
+// Bytes of mips [first_level, end_level) of a width x height image.
+size_t get_mip_chain_size(BlockFormat format, int width, int height, int first_level, int end_level);
+const char *get_block_format_name(BlockFormat format);
+
+// Compresses RGBA8 pixels into the role's format, building every mip level on
+// the CPU. srgb makes the mip filter average in linear light.
+CompressedImage compress_image(const uint8_t *rgba, int width, int height, TextureRole role, bool srgb);
+
+// DDS with the DX10 header; the legacy DXT1/DXT5/ATI2 FourCCs are also read.
+bool write_dds(const std::string &path, const CompressedImage &image);
+
+// Reads mips [first_level, end_level); end_level < 0 means through the last mip.
+// A non-zero max_size raises first_level until that mip fits in max_size x max_size.
+bool read_dds(const std::string &path, CompressedImage &image, int first_level = 0, int end_level = -1, int max_size = 0);
+
+// Decodes source_path with stb_image, compresses it and writes output_path.
+bool cook_texture(const std::string &source_path, const std::string &output_path, TextureRole role, bool srgb);
+
+#endif // TEXTURE_COMPRESSION_HPP
@@ -0,0 +1,75 @@
+#ifndef TEXTURE_STREAMER_HPP
+#define TEXTURE_STREAMER_HPP
+
+#include "texture.hpp"
+#include "texture_compression.hpp"
+#include "thread_pool.hpp"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Keeps cooked textures at the mip level their on-screen size needs.
+// Textures start with only their coarse mips. Finer mips are read from the
+// .dds on the worker pool when the render queue reports the texture drawn
+// large enough. Under the VRAM budget, least recently drawn textures are
+// dropped back to their coarse mips first.
+class TextureStreamer {
+private:
+    struct StreamedTexture {
+        std::weak_ptr<Texture> texture;
+        std::string path;
+        BlockFormat format;
+        int width, height;
+        int coarsest_level; // always resident
+        int wanted_level;
+        uint64_t last_used_frame = 0;
+        bool in_flight = false;
+        size_t pending_bytes = 0; // finer mips requested but not uploaded yet
+        uint64_t serial = 0;      // tells reads for a re-added texture from stale ones
+    };
+
+    struct LoadedLevels {
+        Texture *key;
+        uint64_t serial;
+        std::weak_ptr<Texture> texture;
+        CompressedImage image;
+        bool replace; // drop finer mips: rebuild the texture from this tail
+        bool success;
+    };
+
+    ThreadPool &workers;
+    std::unordered_map<Texture *, StreamedTexture> textures;
+    uint64_t frame = 0;
+    uint64_t next_serial = 1;
+    size_t resident_bytes = 0;
+
+    std::mutex loaded_mutex;
+    std::deque<LoadedLevels> loaded;
+
+    int get_wanted_level(const StreamedTexture &entry, float pixels) const;
+    void request_levels(Texture *key, StreamedTexture &entry, int first_level, int end_level, bool replace);
+    size_t apply_loaded(size_t budget_bytes);
+
+public:
+    explicit TextureStreamer(ThreadPool &workers) : workers(workers) {}
+
+    // Starts streaming a texture whose coarse tail, read from path, was just uploaded.
+    void add(const std::shared_ptr<Texture> &texture, const std::string &path, const CompressedImage &tail);
+    // Stops streaming a texture, e.g. before it is reloaded; reads in flight are dropped.
+    void remove(const Texture *texture);
+
+    // Once per frame: uploads finished reads, then evicts and requests mips
+    // from what the render queue asked for during the last frame.
+    void update(size_t upload_budget_bytes, size_t vram_budget_bytes);
+
+    size_t get_texture_count() const { return textures.size(); }
+    size_t get_resident_bytes() const { return resident_bytes; }
+};
+
+#endif // TEXTURE_STREAMER_HPP
@@ -0,0 +1,51 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads pulling tasks from a shared queue.
+// Tasks must not touch the GL context; hand results back to the main thread instead.
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+
+    void worker_loop();
+
+public:
+    explicit ThreadPool(size_t thread_count = default_thread_count());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    void submit(std::function<void()> task);
+    size_t get_thread_count() const { return workers.size(); }
+
+    // Leaves one hardware thread for the main/render thread.
+    static size_t default_thread_count();
+    // The pool whose worker is calling, or nullptr on any other thread.
+    static ThreadPool *get_current();
+};
+
+// Splits [0, count) into contiguous ranges of at least min_batch items and
+// runs them on pool's workers, the calling thread taking ranges as well.
+// The caller only ever waits for ranges that are already running, never for
+// queued ones, so it is safe to call from inside a task of the same pool,
+// nested calls included. Workers busy with other tasks simply leave more of
+// the ranges to the caller.
+void parallel_for(ThreadPool &pool, size_t count, const std::function<void(size_t begin, size_t end)> &body, size_t min_batch = 1);
+
+// The same on the pool of the calling worker; runs body(0, count) on the
+// calling thread when it is not a pool worker.
+void parallel_for(size_t count, const std::function<void(size_t begin, size_t end)> &body, size_t min_batch = 1);
+
+#endif // THREAD_POOL_HPP
@@ -6,8 +6,13 @@
 #include <string>
 #include <iostream>
 #include <vector>
+#include <cstddef>
+#include <cstdint>
 
 std::vector<float> generate_normal_lines(const std::vector<float> &vertices, const std::vector<float> &normals, float length = 0.1f);
 std::string read_file(const std::string &file_path);
 
+// FNV-1a; pass a previous result as seed to hash several buffers as one.
+uint64_t hash_bytes(const void *data, size_t size, uint64_t seed = 14695981039346656037ull);
+
 #endif // UTILS_HPP
\ No newline at end of file
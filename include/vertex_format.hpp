@@ -0,0 +1,19 @@
+#ifndef VERTEX_FORMAT_HPP
+#define VERTEX_FORMAT_HPP
+
+#include <glm/glm.hpp>
+
+enum class VertexFormat {
+    Standard, // StandardVertex: position, normal, tangent, uv0, uv1
+    Count
+};
+
+struct StandardVertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec4 tangent;
+    glm::vec2 uv0;
+    glm::vec2 uv1;
+};
+
+#endif // VERTEX_FORMAT_HPP
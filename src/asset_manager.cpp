@@ -1,7 +1,389 @@
 #include "asset_manager.hpp"
 
+#include "engine_config.hpp"
+#include "asset_pack.hpp"
+#include "gl_extensions.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+
+namespace {
+    // Cooked output is usable when it exists and its source is missing or
+    // older. A mounted pack is a release build, so what it holds is current.
+    bool is_cooked_file_current(const std::string &source_path, const std::string &cooked_path) {
+        if (AssetPack::contains_mounted(cooked_path)) return true;
+        std::error_code error;
+        if (!std::filesystem::exists(cooked_path, error)) return false;
+        if (source_path == cooked_path || !std::filesystem::exists(source_path, error)) return true;
+        return std::filesystem::last_write_time(cooked_path, error) >= std::filesystem::last_write_time(source_path, error);
+    }
+}
+
+std::shared_ptr<Shader> AssetManager::create_shader(const ShaderSource &source) {
+    auto shader = std::make_shared<Shader>(source);
+    shaders.add(shader);
+    return shader;
+}
+
+std::shared_ptr<Texture> AssetManager::create_texture(const TextureSettings &settings) {
+    auto texture = std::make_shared<Texture>(settings);
+    textures.add(texture);
+    return texture;
+}
+
+std::shared_ptr<Mesh> AssetManager::create_mesh() {
+    auto mesh = std::make_shared<Mesh>();
+    meshes.add(mesh);
+    return mesh;
+}
+
 MaterialBuilder AssetManager::create_material() {
     auto material = std::make_shared<Material>();
-    materials.push_back(material);
-    return MaterialBuilder(material);
-}
\ No newline at end of file
+    materials.add(material);
+    return MaterialBuilder(material, *this);
+}
+
+std::shared_ptr<Shader> AssetManager::load_shader(const std::string &directory) {
+    if (auto shader = shaders.get(directory)) return shader;
+
+    ShaderSource source;
+    if (!source.read(directory)) return std::make_shared<Shader>(source);
+
+    const uint64_t key = source.get_hash();
+    if (auto it = shader_cache.find(key); it != shader_cache.end()) {
+        if (auto shader = it->second.lock()) {
+            shaders.add(shader, directory);
+            return shader;
+        }
+    }
+
+    // Registered even when it fails to build, so a hot reload can fix it in place.
+    auto shader = std::make_shared<Shader>(source);
+    shaders.add(shader, directory);
+    if (shader->get_program()) shader_cache[key] = shader;
+
+    for (const std::string &file : {source.vertex_path, source.fragment_path}) {
+        watcher.watch(file);
+        shaders_by_file[FileWatcher::normalize(file)].push_back(shader);
+    }
+    return shader;
+}
+
+std::string AssetManager::get_texture_key(const std::string &path, const TextureSettings &settings) {
+    return path + "|" + settings.get_key();
+}
+
+std::shared_ptr<Texture> AssetManager::load_texture(const std::string &path, const TextureSettings &settings) {
+    const std::string key = get_texture_key(path, settings);
+    if (auto texture = textures.get(key)) return texture;
+
+    auto texture = std::make_shared<Texture>(settings);
+    textures.add(texture, key);
+    watcher.watch(path);
+    textures_by_file[FileWatcher::normalize(path)].push_back(texture);
+    queue_texture_decode(texture, path);
+    return texture;
+}
+
+void AssetManager::queue_texture_decode(const std::shared_ptr<Texture> &texture, const std::string &path) {
+    texture_decode_count++;
+    textures_in_flight++;
+
+    workers.submit([this, target = std::weak_ptr<Texture>(texture), path]() {
+        DecodedTexture decoded{target, {}, TextureImage(), CompressedImage(), false, false, path, "", false};
+
+        // Prefer a cooked .dds that is at least as new as its source and that
+        // this context can sample; otherwise decode the source image.
+        const bool is_dds = std::filesystem::path(path).extension() == ".dds";
+        const std::string cooked_path = is_dds ? path : get_cooked_path(path, ".dds");
+        // With streaming on, only the coarse tail is read here; TextureStreamer
+        // brings in finer mips once the texture is drawn large enough.
+        const int max_size = config.texture_streaming ? config.texture_stream_initial_size : 0;
+        if (is_cooked_file_current(path, cooked_path) && read_dds(cooked_path, decoded.compressed, 0, -1, max_size) &&
+            is_block_format_supported(decoded.compressed.format)) {
+            decoded.is_compressed = true;
+            decoded.is_streamed = decoded.compressed.first_level > 0;
+            decoded.cooked_path = cooked_path;
+            decoded.success = true;
+        } else if (!is_dds) {
+            decoded.success = decoded.image.decode(path);
+        }
+
+        std::lock_guard<std::mutex> lock(decoded_textures_mutex);
+        decoded_textures.push_back(std::move(decoded));
+    });
+}
+
+std::shared_ptr<TextureLayer> AssetManager::load_texture_layer(const std::string &path) {
+    auto it = texture_layer_cache.find(path);
+    if (it != texture_layer_cache.end()) {
+        if (auto layer = it->second.lock()) return layer;
+    }
+
+    auto layer = std::make_shared<TextureLayer>();
+    texture_layer_cache[path] = layer;
+    watcher.watch(path);
+    queue_texture_layer_decode(layer, path);
+    return layer;
+}
+
+void AssetManager::queue_texture_layer_decode(const std::shared_ptr<TextureLayer> &layer, const std::string &path) {
+    texture_decode_count++;
+    textures_in_flight++;
+
+    workers.submit([this, target = std::weak_ptr<TextureLayer>(layer), path]() {
+        DecodedTexture decoded{{}, target, TextureImage(), CompressedImage(), false, false, path, "", false};
+        decoded.success = decoded.image.decode(path, 4);
+
+        std::lock_guard<std::mutex> lock(decoded_textures_mutex);
+        decoded_textures.push_back(std::move(decoded));
+    });
+}
+
+bool AssetManager::pack_texture(const TextureImage &image, TextureLayer &layer) {
+    if (std::max(image.width, image.height) <= config.atlas_max_texture_size) {
+        if (!texture_atlas) {
+            texture_atlas = std::make_unique<TextureAtlas>(config.atlas_page_size, config.atlas_padding);
+        }
+        if (texture_atlas->add(image, layer)) return true;
+    }
+
+    auto &array = texture_arrays[{image.width, image.height}];
+    if (!array) array = std::make_shared<TextureArray>(image.width, image.height);
+
+    layer.layer = array->add_layer();
+    array->write(layer.layer, 0, 0, image.width, image.height, image.pixels.get());
+    array->generate_mipmaps();
+    layer.array = array;
+    layer.rect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+    return true;
+}
+
+std::shared_ptr<Mesh> AssetManager::load_mesh_async(const std::string &path) {
+    if (auto mesh = meshes.get(path)) return mesh;
+
+    auto mesh = std::make_shared<Mesh>();
+    meshes.add(mesh, path);
+    mesh->set_pending(true);
+    watcher.watch(path);
+    meshes_by_file[FileWatcher::normalize(path)].push_back(mesh);
+    queue_mesh_import(mesh, path);
+    return mesh;
+}
+
+void AssetManager::queue_mesh_import(const std::shared_ptr<Mesh> &mesh, const std::string &path) {
+    meshes_in_flight++;
+
+    workers.submit([this, mesh, path]() {
+        // Prefer what the asset cooker wrote; Assimp import is the slow path.
+        auto data = std::make_unique<Mesh>();
+        const std::string cooked_path = get_cooked_path(path, ".mesh");
+        bool success = (is_cooked_file_current(path, cooked_path) && data->read_cooked(cooked_path)) || data->load(path);
+
+        std::lock_guard<std::mutex> lock(loaded_meshes_mutex);
+        loaded_meshes.push_back({mesh, std::move(data), path, success});
+    });
+}
+
+size_t AssetManager::process_pending_uploads(double budget_ms) {
+    using clock = std::chrono::steady_clock;
+    const auto deadline = clock::now() + std::chrono::duration<double, std::milli>(budget_ms);
+
+    size_t uploaded = 0;
+    while (true) {
+        LoadedMesh loaded;
+        {
+            std::lock_guard<std::mutex> lock(loaded_meshes_mutex);
+            if (loaded_meshes.empty()) break;
+            loaded = std::move(loaded_meshes.front());
+            loaded_meshes.pop_front();
+        }
+        meshes_in_flight--;
+
+        if (!loaded.success) {
+            // Leave the placeholder pending so it keeps drawing nothing.
+            std::cerr << "AssetManager: failed to load mesh at " << loaded.path << "\n";
+            continue;
+        }
+
+        loaded.target->adopt(std::move(*loaded.data));
+        loaded.target->upload_to_GPU();
+        uploaded++;
+
+        if (clock::now() >= deadline) break;
+    }
+
+    return uploaded;
+}
+
+size_t AssetManager::process_pending_texture_uploads(size_t budget_bytes) {
+    size_t uploaded = 0;
+    size_t bytes_sent = 0;
+    while (bytes_sent < budget_bytes || uploaded == 0) {
+        DecodedTexture decoded;
+        {
+            std::lock_guard<std::mutex> lock(decoded_textures_mutex);
+            if (decoded_textures.empty()) break;
+            decoded = std::move(decoded_textures.front());
+            decoded_textures.pop_front();
+        }
+        textures_in_flight--;
+
+        if (!decoded.success) {
+            // Keep the placeholder so materials still have something to sample.
+            std::cerr << "AssetManager: failed to load texture from " << decoded.path << "\n";
+            continue;
+        }
+
+        if (auto layer = decoded.layer.lock()) {
+            pack_texture(decoded.image, *layer);
+            bytes_sent += decoded.image.get_size();
+            uploaded++;
+            continue;
+        }
+
+        auto texture = decoded.target.lock();
+        if (!texture) continue; // every handle was dropped while decoding
+
+        // A reload: start from empty storage, the new image may differ in size and format.
+        if (!texture->is_pending()) {
+            streamer.remove(texture.get());
+            texture->reset_storage();
+        }
+
+        if (decoded.is_compressed) {
+            texture->upload(decoded.compressed);
+            bytes_sent += decoded.compressed.get_size();
+            if (decoded.is_streamed) streamer.add(texture, decoded.cooked_path, decoded.compressed);
+        } else {
+            texture->upload(decoded.image);
+            bytes_sent += decoded.image.get_size();
+        }
+        uploaded++;
+    }
+
+    if (config.texture_streaming) streamer.update(budget_bytes, config.texture_vram_budget_bytes);
+
+    return uploaded;
+}
+
+void AssetManager::process_file_changes() {
+    if (!config.hot_reload) return;
+    for (const std::string &path : watcher.poll()) reload_file(path);
+}
+
+void AssetManager::reload_file(const std::string &path) {
+    std::cout << "AssetManager: reloading " << path << "\n";
+
+    if (auto it = shaders_by_file.find(path); it != shaders_by_file.end()) {
+        std::erase_if(it->second, [](const std::weak_ptr<Shader> &shader) { return shader.expired(); });
+        for (const auto &weak_shader : it->second) {
+            auto shader = weak_shader.lock();
+            ShaderSource source;
+            if (!source.read(shader->get_source().vertex_path, shader->get_source().fragment_path)) continue;
+
+            const uint64_t old_key = shader->get_source_hash();
+            if (!shader->reload(source)) {
+                std::cerr << "AssetManager: keeping the previous program for " << path << "\n";
+                continue;
+            }
+            shader_cache.erase(old_key);
+            shader_cache[shader->get_source_hash()] = shader;
+        }
+    }
+
+    if (auto it = textures_by_file.find(path); it != textures_by_file.end()) {
+        std::erase_if(it->second, [](const std::weak_ptr<Texture> &texture) { return texture.expired(); });
+        for (const auto &weak_texture : it->second) {
+            if (auto texture = weak_texture.lock()) queue_texture_decode(texture, path);
+        }
+    }
+    // Packed textures take a new region; the old one is not reclaimed.
+    for (const auto &[layer_path, weak_layer] : texture_layer_cache) {
+        if (FileWatcher::normalize(layer_path) != path) continue;
+        if (auto layer = weak_layer.lock()) queue_texture_layer_decode(layer, layer_path);
+    }
+
+    // The old geometry keeps drawing until the new import is uploaded.
+    if (auto it = meshes_by_file.find(path); it != meshes_by_file.end()) {
+        std::erase_if(it->second, [](const std::weak_ptr<Mesh> &mesh) { return mesh.expired(); });
+        for (const auto &weak_mesh : it->second) {
+            if (auto mesh = weak_mesh.lock()) queue_mesh_import(mesh, path);
+        }
+    }
+}
+
+void AssetManager::unload_unused() {
+    const size_t unloaded = retire_unused();
+    unload_requested = unloaded > 0 || !retired_assets.empty();
+    if (unloaded > 0) std::cout << "AssetManager: unloading " << unloaded << " unused assets\n";
+}
+
+size_t AssetManager::retire_unused() {
+    auto retire = [this](std::shared_ptr<void> asset) { retired_assets.push_back({std::move(asset), frame}); };
+
+    size_t unloaded = materials.unload_unused(retire);
+    unloaded += shaders.unload_unused(retire);
+    unloaded += meshes.unload_unused(retire);
+    unloaded += textures.unload_unused([&](std::shared_ptr<Texture> texture) {
+        // The streamer keys textures by address, which a new texture may reuse.
+        streamer.remove(texture.get());
+        retire(std::move(texture));
+    });
+    return unloaded;
+}
+
+void AssetManager::collect_garbage() {
+    frame++;
+
+    bool destroyed = false;
+    while (!retired_assets.empty() &&
+           retired_assets.front().frame + static_cast<uint64_t>(config.asset_release_delay_frames) <= frame) {
+        retired_assets.pop_front();
+        destroyed = true;
+    }
+    if (!destroyed) return;
+    prune_expired();
+
+    // Destroyed assets may have been the last users of others, e.g. a material of its textures.
+    if (unload_requested && retire_unused() == 0 && retired_assets.empty()) unload_requested = false;
+}
+
+// Forgets lookups of assets that no longer exist.
+void AssetManager::prune_expired() {
+    auto prune = [](auto &map) {
+        for (auto it = map.begin(); it != map.end();) {
+            std::erase_if(it->second, [](const auto &weak) { return weak.expired(); });
+            it = it->second.empty() ? map.erase(it) : std::next(it);
+        }
+    };
+    prune(shaders_by_file);
+    prune(textures_by_file);
+    prune(meshes_by_file);
+
+    std::erase_if(shader_cache, [](const auto &entry) { return entry.second.expired(); });
+    std::erase_if(texture_layer_cache, [](const auto &entry) { return entry.second.expired(); });
+}
+
+std::string AssetManager::get_cooked_path(const std::string &source_path, const std::string &extension) {
+    return (std::filesystem::path(config.cooked_asset_dir) / (source_path + extension)).generic_string();
+}
+
+void AssetManager::shutdown() {
+    // Assets the scene still holds outlive this; everything else goes while the context is current.
+    retired_assets.clear();
+    materials.clear();
+    shaders.clear();
+    meshes.clear();
+    textures.clear();
+}
+
+std::vector<MeshMemoryStats> AssetManager::get_mesh_memory_stats() const {
+    std::vector<MeshMemoryStats> stats;
+    stats.reserve(meshes.get_count());
+    meshes.for_each([&](Mesh &mesh) {
+        stats.push_back({mesh.get_name(), mesh.get_cpu_bytes(), mesh.get_gpu_bytes()});
+    });
+    return stats;
+}
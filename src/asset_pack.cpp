@@ -0,0 +1,255 @@
+#include "asset_pack.hpp"
+#include "lz4_block.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    constexpr char pack_magic[4] = {'A', 'P', 'A', 'K'};
+
+    struct PackHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t entry_count;
+        uint32_t reserved;
+        uint64_t toc_offset;
+        uint64_t toc_size;
+    };
+
+    // Followed by name_length bytes of name.
+    struct PackTocEntry {
+        uint64_t offset;
+        uint64_t size;
+        uint64_t stored_size;
+        uint64_t hash;
+        uint32_t compression;
+        uint32_t name_length;
+    };
+
+    bool read_whole_file(const std::string &path, std::vector<uint8_t> &bytes) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) return false;
+        bytes.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char *>(bytes.data()), bytes.size());
+        return bool(file);
+    }
+
+    void pad_to(std::ofstream &file, uint64_t alignment) {
+        static const char zeros[AssetPack::alignment] = {};
+        const uint64_t position = static_cast<uint64_t>(file.tellp());
+        const uint64_t padding = (alignment - position % alignment) % alignment;
+        file.write(zeros, static_cast<std::streamsize>(padding));
+    }
+}
+
+std::string AssetPack::normalize_name(const std::string &path) {
+    return std::filesystem::path(path).lexically_normal().generic_string();
+}
+
+bool AssetPack::open(const std::string &path) {
+    entries.clear();
+    if (!file.open(path)) return false;
+
+    const uint8_t *data = file.get_data();
+    const size_t size = file.get_size();
+
+    PackHeader header;
+    if (size < sizeof(header)) {
+        std::cerr << "AssetPack: " << path << " is truncated\n";
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, pack_magic, sizeof(pack_magic)) != 0 || header.version != version) {
+        std::cerr << "AssetPack: " << path << " is not a version " << version << " pack\n";
+        return false;
+    }
+    if (header.toc_offset > size || header.toc_size > size - header.toc_offset) {
+        std::cerr << "AssetPack: " << path << " is truncated\n";
+        return false;
+    }
+
+    entries.reserve(header.entry_count);
+    size_t position = header.toc_offset;
+    const size_t toc_end = header.toc_offset + header.toc_size;
+    for (uint32_t i = 0; i < header.entry_count; ++i) {
+        PackTocEntry record;
+        if (toc_end - position < sizeof(record)) break;
+        std::memcpy(&record, data + position, sizeof(record));
+        position += sizeof(record);
+        if (toc_end - position < record.name_length) break;
+
+        Entry entry;
+        entry.name.assign(reinterpret_cast<const char *>(data + position), record.name_length);
+        position += record.name_length;
+        entry.offset = record.offset;
+        entry.size = record.size;
+        entry.stored_size = record.stored_size;
+        entry.hash = record.hash;
+        entry.compression = static_cast<PackCompression>(record.compression);
+
+        // Everything read() later trusts: the stored bytes lie inside the
+        // mapping, an uncompressed entry is exactly its stored bytes, and the
+        // names stay sorted for find().
+        if (entry.offset > size || entry.stored_size > size - entry.offset) break;
+        if (entry.compression == PackCompression::None && entry.size != entry.stored_size) break;
+        if (entry.compression != PackCompression::None && entry.compression != PackCompression::LZ4) break;
+        if (!entries.empty() && !(entries.back().name < entry.name)) break;
+        entries.push_back(std::move(entry));
+    }
+
+    if (entries.size() != header.entry_count) {
+        std::cerr << "AssetPack: " << path << " has a damaged table of contents\n";
+        entries.clear();
+        file.close();
+        return false;
+    }
+    return true;
+}
+
+const AssetPack::Entry *AssetPack::find(const std::string &name) const {
+    const std::string key = normalize_name(name);
+    auto it = std::lower_bound(entries.begin(), entries.end(), key,
+                               [](const Entry &entry, const std::string &value) { return entry.name < value; });
+    return it != entries.end() && it->name == key ? &*it : nullptr;
+}
+
+bool AssetPack::read(const Entry &entry, AssetBytes &bytes) const {
+    const uint8_t *stored = file.get_data() + entry.offset;
+    bytes.storage.clear();
+
+    switch (entry.compression) {
+        case PackCompression::None:
+            bytes.data = stored;
+            bytes.size = entry.stored_size; // equal to entry.size, checked by open()
+            break;
+        case PackCompression::LZ4:
+            bytes.storage.resize(entry.size);
+            if (!lz4_decompress(stored, entry.stored_size, bytes.storage.data(), bytes.storage.size())) {
+                std::cerr << "AssetPack: " << entry.name << " is corrupt\n";
+                return false;
+            }
+            bytes.data = bytes.storage.data();
+            bytes.size = bytes.storage.size();
+            break;
+        default:
+            std::cerr << "AssetPack: " << entry.name << " uses an unknown compression\n";
+            return false;
+    }
+
+    return true;
+}
+
+bool AssetPack::verify() const {
+    bool valid = true;
+    AssetBytes bytes;
+    for (const Entry &entry : entries) {
+        if (!read(entry, bytes)) {
+            valid = false;
+        } else if (hash_bytes(bytes.data, bytes.size) != entry.hash) {
+            std::cerr << "AssetPack: " << entry.name << " does not match its stored hash\n";
+            valid = false;
+        }
+    }
+    return valid;
+}
+
+bool AssetPack::mount(const std::string &path, bool verify) {
+    auto pack = std::make_unique<AssetPack>();
+    if (!pack->open(path)) return false;
+    if (verify && !pack->verify()) {
+        std::cerr << "AssetPack: " << path << " failed verification\n";
+        return false;
+    }
+
+    std::cout << "AssetPack: mounted " << path << " (" << pack->entries.size() << " entries)\n";
+    mounted = std::move(pack);
+    return true;
+}
+
+bool AssetPack::read_mounted(const std::string &path, AssetBytes &bytes) {
+    if (!mounted) return false;
+    const Entry *entry = mounted->find(path);
+    return entry && mounted->read(*entry, bytes);
+}
+
+bool AssetPack::contains_mounted(const std::string &path) {
+    return mounted && mounted->find(path);
+}
+
+bool write_asset_pack(const std::string &path, const std::vector<AssetPackInput> &inputs, bool compress) {
+    std::vector<AssetPackInput> sorted = inputs;
+    for (AssetPackInput &input : sorted) input.name = AssetPack::normalize_name(input.name);
+    std::sort(sorted.begin(), sorted.end(), [](const AssetPackInput &a, const AssetPackInput &b) { return a.name < b.name; });
+    auto duplicate = std::adjacent_find(sorted.begin(), sorted.end(),
+                                        [](const AssetPackInput &a, const AssetPackInput &b) { return a.name == b.name; });
+    if (duplicate != sorted.end()) {
+        std::cerr << "write_asset_pack: " << duplicate->name << " is listed twice\n";
+        return false;
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "write_asset_pack: failed to create " << path << "\n";
+        return false;
+    }
+
+    PackHeader header = {};
+    std::memcpy(header.magic, pack_magic, sizeof(pack_magic));
+    header.version = AssetPack::version;
+    header.entry_count = static_cast<uint32_t>(sorted.size());
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    std::vector<PackTocEntry> records;
+    records.reserve(sorted.size());
+    std::vector<uint8_t> bytes;
+    for (const AssetPackInput &input : sorted) {
+        if (!read_whole_file(input.source_path, bytes)) {
+            std::cerr << "write_asset_pack: failed to read " << input.source_path << "\n";
+            return false;
+        }
+
+        PackTocEntry record = {};
+        record.size = bytes.size();
+        record.hash = hash_bytes(bytes.data(), bytes.size());
+        record.name_length = static_cast<uint32_t>(input.name.size());
+
+        // Streamed textures are read by mip range, again and again; decompressing
+        // the whole file for each range would cost more than the disk it saves.
+        const bool compressible = compress && std::filesystem::path(input.name).extension() != ".dds";
+        std::vector<uint8_t> compressed;
+        if (compressible) compressed = lz4_compress(bytes.data(), bytes.size());
+        const bool use_compressed = compressible && compressed.size() <= bytes.size() - bytes.size() / 8;
+        const std::vector<uint8_t> &stored = use_compressed ? compressed : bytes;
+        record.compression = static_cast<uint32_t>(use_compressed ? PackCompression::LZ4 : PackCompression::None);
+        record.stored_size = stored.size();
+
+        pad_to(file, AssetPack::alignment);
+        record.offset = static_cast<uint64_t>(file.tellp());
+        file.write(reinterpret_cast<const char *>(stored.data()), static_cast<std::streamsize>(stored.size()));
+        records.push_back(record);
+    }
+
+    header.toc_offset = static_cast<uint64_t>(file.tellp());
+    for (size_t i = 0; i < records.size(); ++i) {
+        file.write(reinterpret_cast<const char *>(&records[i]), sizeof(records[i]));
+        file.write(sorted[i].name.data(), static_cast<std::streamsize>(sorted[i].name.size()));
+    }
+    header.toc_size = static_cast<uint64_t>(file.tellp()) - header.toc_offset;
+
+    file.seekp(0);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.close();
+    if (!file) {
+        std::cerr << "write_asset_pack: failed to write " << path << "\n";
+        return false;
+    }
+
+    // Catches a bad write or compressor once here, so readers can skip the hashes.
+    AssetPack written;
+    return written.open(path) && written.verify();
+}
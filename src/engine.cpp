@@ -1,11 +1,23 @@
 #include "engine.hpp"
 
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+
 // engine.cpp
 bool EngineCore::initialize() {
+    Profiler::set_thread_name("main");
+
     try {
         if (!create_window()) throw std::runtime_error("Window creation failed");
         if (!init_gl_context()) throw std::runtime_error("GL context initialization failed");
         if (!setup_callbacks()) throw std::runtime_error("Callback setup failed");
+        frame_times.set_keep_all(config.frame_time_csv_path[0] != '\0');
+
+        // Files in the pack are read from its mapping instead of from disk.
+        if (std::filesystem::exists(config.asset_pack) && !AssetPack::mount(config.asset_pack, config.verify_asset_pack)) {
+            throw std::runtime_error("Asset pack mount failed");
+        }
         if (!setup_scene()) throw std::runtime_error("Scene setup failed");
 
         IMGUI_CHECKVERSION();
@@ -36,6 +48,17 @@ bool EngineCore::run() {
 }
 
 void EngineCore::shutdown() {
+    if (config.frame_time_csv_path[0] != '\0' && frame_times.write_csv(config.frame_time_csv_path)) {
+        std::cout << "Frame times written to " << config.frame_time_csv_path << "\n";
+    }
+
+    render_queue.shutdown();
+    assets.shutdown();
+    GeometryArena::shutdown_all();
+    SamplerCache::shutdown();
+    Shader::shutdown();
+    GpuProfiler::shutdown();
+
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -55,6 +78,16 @@ void EngineCore::main_loop() {
     const double time_step = 1.0 / config.target_fps;
 
     while (!glfwWindowShouldClose(window)) {
+        Profiler::mark_frame();
+        PROFILE_SCOPE("main_loop");
+        const double frame_start = glfwGetTime();
+        const uint64_t frame_index = frame_times.get_frame_count();
+
+        GpuProfiler::begin_frame(frame_index);
+        for (const auto &[frame, gpu_ms] : GpuProfiler::get_newly_completed_frames()) {
+            frame_times.add_gpu_frame(frame, static_cast<float>(gpu_ms));
+        }
+
         const double current_time = glfwGetTime();
         double delta_time = current_time - last_time;
         last_time = current_time;
@@ -67,11 +100,23 @@ void EngineCore::main_loop() {
             accumulator -= time_step;
         }
 
+        // Pick up edited assets, then finish async imports without stalling the frame
+        {
+            PROFILE_SCOPE("Asset uploads");
+            assets.process_file_changes();
+            assets.process_pending_uploads(config.mesh_upload_budget_ms);
+            assets.process_pending_texture_uploads(config.texture_upload_budget_bytes);
+            assets.collect_garbage();
+        }
+
         /* IMGUI */
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
-        ImGui::NewFrame();
-        render_ui();
+        {
+            PROFILE_SCOPE("render_ui");
+            ImGui_ImplOpenGL3_NewFrame();
+            ImGui_ImplGlfw_NewFrame();
+            ImGui::NewFrame();
+            render_ui();
+        }
         /* END IMGUI*/
 
         // Rendering
@@ -79,14 +124,25 @@ void EngineCore::main_loop() {
         render_scene(aspect_ratio);
 
         /* IMGUI */
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        {
+            PROFILE_SCOPE("ImGui render");
+            GpuPassScope gpu_pass("UI");
+            ImGui::Render();
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        }
         /* END IMGUI */
+        GpuProfiler::end_frame();
 
-        glfwSwapBuffers(window);
+        {
+            PROFILE_SCOPE("Swap buffers");
+            glfwSwapBuffers(window);
+        }
+        render_stats_history.end_frame();
         glfwPollEvents();
 
         process_debug_input();
+
+        frame_times.add_cpu_frame(static_cast<float>((glfwGetTime() - frame_start) * 1000.0), 1000.0f / config.target_fps);
     }
 }
 
@@ -126,6 +182,8 @@ bool EngineCore::init_gl_context() {
         std::cerr << "Failed to initialize GLAD\n";
         return false;
     }
+    load_gl_extensions((GLADloadproc)glfwGetProcAddress);
+    GpuProfiler::initialize();
 
     glViewport(0, 0, config.screen_width, config.screen_height);
     glEnable(GL_DEPTH_TEST);
@@ -160,7 +218,6 @@ bool EngineCore::setup_scene() {
     active_scene->set_main_camera(camera);
 
     // Load assets
-    AssetManager assets;
     auto material = assets.create_material()
         .with_preset(MaterialPreset::Simple)
         .build();
@@ -175,33 +232,36 @@ bool EngineCore::setup_scene() {
 
 
 
-    auto ground_texture = std::make_shared<Texture>("src/textures/ground.jpg");
+    auto ground_texture = assets.load_texture("src/textures/ground.jpg");
     active_scene->create_game_object("Ground")
-        .with_render_mesh("src/objects/plane_usd.obj")
+        .with_model_async("src/objects/plane_usd.obj", assets)
         .with_material(material)
         .with_transform(TransformParams{.scale = glm::vec3(100.0f)})
         .build();
 
     active_scene->create_game_object("UtahBlendModel")
-        .with_render_mesh("src/objects/UTAH_BLEND.obj")
+        .with_model_async("src/objects/UTAH_BLEND.obj", assets)
         .with_material(material)
         .with_transform(TransformParams{.position = glm::vec3(0.0, 1.0, 0.0)})
         .build();
 
     active_scene->create_game_object("Cube")
-        .with_render_mesh("src/objects/cube.obj")
+        .with_model_async("src/objects/cube.obj", assets)
         .with_material(cube_material)
         .with_transform(TransformParams{.position = glm::vec3(2.0, 0.5, 2.0)})
         .build();
 
     active_scene->create_game_object("Cottage")
-        .with_render_mesh("src/objects/Cottage.fbx")
+        .with_model_async("src/objects/Cottage.fbx", assets)
         .with_material(cottage_material)
         .with_transform(TransformParams{.position = glm::vec3(-20, 0, -20), .scale = glm::vec3(0.01)})
         .build();
 
     active_scene->start();
 
+    // Whatever only the previous scene used goes now; shared assets were reused above.
+    assets.unload_unused();
+
     return true;
 }
 
@@ -213,12 +273,18 @@ void EngineCore::process_debug_input() {
         // set_wireframe_mode(config.wireframe_mode);
     }
 
+    if (InputState::is_key_just_pressed(GLFW_KEY_F5)) {
+        selected_game_object = nullptr;
+        setup_scene();
+    }
+
     if (InputState::is_key_just_pressed(GLFW_KEY_ESCAPE)) {
         glfwSetWindowShouldClose(window, GL_TRUE);
     }
 }
 
 bool EngineCore::render_scene(const float aspect_ratio) {
+    PROFILE_SCOPE("render_scene");
     bool success = true;
     
     auto camera = active_scene->get_main_camera();
@@ -241,20 +307,26 @@ bool EngineCore::render_scene(const float aspect_ratio) {
     glm::mat4 view = camera_component->get_view_matrix(camera_transform->position, camera_transform->get_front(), camera_transform->get_up());
 
     camera_component->set_viewport();
-    camera_component->clear(view, projection);
+    {
+        GpuPassScope gpu_pass("Clear + skybox");
+        camera_component->clear(view, projection);
+    }
 
+    render_queue.clear();
     for (auto &game_object : active_scene->get_game_objects()) {
         auto render_mesh_component = game_object->get_component<RenderMeshComponent>();
         if (!render_mesh_component) {
             continue;
         }
 
-        success = render_mesh_component->render(projection, view, camera_position, light_properties);
+        success = render_mesh_component->enqueue(render_queue);
         if (!success) {
             std::cerr << "Render: '" << game_object->name << "' failed to render\n";
         }
     }
 
+    render_queue.flush(FrameParams{projection, view, camera_position, light_properties});
+
     return true;
 }
 
@@ -265,6 +337,10 @@ bool EngineCore::render_ui() {
     // Display FPS
     ImGui::Text("FPS: %.1f", ImGui::GetIO().Framerate);
 
+    if (ImGui::CollapsingHeader("Frame Times")) {
+        draw_frame_times();
+    }
+
     // Scene Hierarchy
     if (ImGui::CollapsingHeader("Scene Hierarchy", ImGuiTreeNodeFlags_DefaultOpen)) {
         if (active_scene) {
@@ -280,12 +356,49 @@ bool EngineCore::render_ui() {
         }
     }
 
+    // Asset memory
+    if (ImGui::CollapsingHeader("Mesh Memory")) {
+        size_t total_cpu_bytes = 0;
+        size_t total_gpu_bytes = 0;
+        for (const auto &stats : assets.get_mesh_memory_stats()) {
+            ImGui::Text("%s: CPU %.1f KB, GPU %.1f KB", stats.name.c_str(), stats.cpu_bytes / 1024.0, stats.gpu_bytes / 1024.0);
+            total_cpu_bytes += stats.cpu_bytes;
+            total_gpu_bytes += stats.gpu_bytes;
+        }
+        ImGui::Text("Textures decoded: %zu (%zu pending)", assets.get_texture_decode_count(), assets.get_pending_texture_count());
+        const TextureStreamer &streamer = assets.get_texture_streamer();
+        ImGui::Text("Streamed textures: %zu, %.2f / %.2f MB", streamer.get_texture_count(),
+                    streamer.get_resident_bytes() / (1024.0 * 1024.0), config.texture_vram_budget_bytes / (1024.0 * 1024.0));
+        ImGui::Separator();
+        ImGui::Text("Total: CPU %.2f MB, GPU %.2f MB", total_cpu_bytes / (1024.0 * 1024.0), total_gpu_bytes / (1024.0 * 1024.0));
+        ImGui::Text("Assets: %zu shaders, %zu textures, %zu meshes, %zu materials (%zu unloading)",
+                    assets.get_shaders().get_count(), assets.get_textures().get_count(),
+                    assets.get_meshes().get_count(), assets.get_materials().get_count(), assets.get_retired_asset_count());
+        if (ImGui::Button("Unload Unused Assets")) assets.unload_unused();
+
+        if (GeometryArena *arena = GeometryArena::find(VertexFormat::Standard)) {
+            ImGui::Text("Arena vertices: %u / %u", arena->get_vertex_ranges().get_used(), arena->get_vertex_ranges().get_capacity());
+            ImGui::Text("Arena indices: %u / %u", arena->get_index_ranges().get_used(), arena->get_index_ranges().get_capacity());
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Render Stats")) {
+        draw_render_stats();
+    }
+
+    if (ImGui::CollapsingHeader("Profiler")) {
+        draw_gpu_pass_timings();
+        ImGui::Separator();
+        draw_profiler_timeline();
+    }
+
     // Debug controls
     if (ImGui::CollapsingHeader("Debug Controls")) {
         if (ImGui::Checkbox("Wireframe Mode", &config.wireframe_mode)) {
             // set_wireframe_mode(config.wireframe_mode);
         }
         ImGui::Checkbox("Debug Mode", &config.debug_mode);
+        ImGui::SliderFloat("Max Anisotropy", &config.max_anisotropy, 1.0f, 16.0f, "%.0fx");
     }
 
     if (ImGui::Button("Exit")) {
@@ -317,4 +430,175 @@ void EngineCore::draw_properties_window() {
     selected_game_object->draw_inspector_ui();
 
     ImGui::End();
-}
\ No newline at end of file
+}
+
+// Graph, distribution and percentiles of the last FrameTimeTracker::history_size frames.
+void EngineCore::draw_frame_times() {
+    const float budget_ms = 1000.0f / config.target_fps;
+    const std::vector<float> cpu_history = frame_times.get_cpu_history();
+    const std::vector<float> gpu_history = frame_times.get_gpu_history();
+    const FrameTimeTracker::Percentiles cpu = frame_times.get_cpu_percentiles();
+    const FrameTimeTracker::Percentiles gpu = frame_times.get_gpu_percentiles();
+
+    // Same scale for both graphs, at least twice the budget so it stays readable.
+    const float scale_max = std::max({budget_ms * 2.0f, cpu.max, gpu.max});
+    const ImVec2 graph_size(0.0f, 60.0f);
+    char overlay[64];
+    std::snprintf(overlay, sizeof(overlay), "budget %.2f ms", budget_ms);
+    ImGui::PlotLines("CPU (ms)", cpu_history.data(), static_cast<int>(cpu_history.size()), 0, overlay, 0.0f, scale_max, graph_size);
+    if (!gpu_history.empty()) {
+        ImGui::PlotLines("GPU (ms)", gpu_history.data(), static_cast<int>(gpu_history.size()), 0, nullptr, 0.0f, scale_max, graph_size);
+    }
+
+    // How many frames fell in each slice of [0, 3 x budget]; the last bucket takes the rest.
+    constexpr int bucket_count = 30;
+    float buckets[bucket_count] = {};
+    for (float ms : cpu_history) {
+        const int bucket = static_cast<int>(ms / (budget_ms * 3.0f) * bucket_count);
+        buckets[std::clamp(bucket, 0, bucket_count - 1)] += 1.0f;
+    }
+    ImGui::PlotHistogram("CPU distribution", buckets, bucket_count, 0, "0 .. 3x budget", 0.0f, FLT_MAX, graph_size);
+
+    if (ImGui::BeginTable("frame_time_percentiles", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit)) {
+        ImGui::TableSetupColumn("ms");
+        ImGui::TableSetupColumn("p50");
+        ImGui::TableSetupColumn("p95");
+        ImGui::TableSetupColumn("p99");
+        ImGui::TableSetupColumn("max");
+        ImGui::TableHeadersRow();
+        const std::pair<const char *, FrameTimeTracker::Percentiles> rows[] = {{"CPU", cpu}, {"GPU", gpu}};
+        for (const auto &[name, percentiles] : rows) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(name);
+            for (float value : {percentiles.p50, percentiles.p95, percentiles.p99, percentiles.max}) {
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", value);
+            }
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::Text("Hitches (over %.2f ms): %llu of %llu frames", budget_ms,
+                static_cast<unsigned long long>(frame_times.get_hitch_count()),
+                static_cast<unsigned long long>(frame_times.get_frame_count()));
+    ImGui::SameLine();
+    if (ImGui::SmallButton("Reset")) frame_times.reset_hitch_count();
+}
+
+// Each counter over the last RenderStatsHistory::frame_count frames.
+void EngineCore::draw_render_stats() {
+    ImGui::Text("Over the last %zu frames", render_stats_history.get_frame_count());
+    if (!ImGui::BeginTable("render_stats", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)) return;
+
+    ImGui::TableSetupColumn("Counter");
+    ImGui::TableSetupColumn("Last");
+    ImGui::TableSetupColumn("Min");
+    ImGui::TableSetupColumn("Avg");
+    ImGui::TableSetupColumn("Max");
+    ImGui::TableHeadersRow();
+
+    const RenderStats &last = render_stats_history.get_last_frame();
+    for (const RenderStats::Field &field : RenderStats::fields) {
+        const RenderStatsHistory::Summary summary = render_stats_history.summarize(field.value);
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(field.name);
+        ImGui::TableNextColumn();
+        ImGui::Text("%llu", static_cast<unsigned long long>(last.*field.value));
+        ImGui::TableNextColumn();
+        ImGui::Text("%llu", static_cast<unsigned long long>(summary.min));
+        ImGui::TableNextColumn();
+        ImGui::Text("%.1f", summary.average);
+        ImGui::TableNextColumn();
+        ImGui::Text("%llu", static_cast<unsigned long long>(summary.max));
+    }
+    ImGui::EndTable();
+}
+
+void EngineCore::draw_gpu_pass_timings() {
+    if (!GpuProfiler::is_supported()) {
+        ImGui::TextDisabled("GPU timing: no timer queries on this context");
+        return;
+    }
+    ImGui::Checkbox("GPU Timing", &config.gpu_timing);
+    if (!config.gpu_timing) return;
+
+    if (ImGui::BeginTable("gpu_passes", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit)) {
+        ImGui::TableSetupColumn("GPU pass");
+        ImGui::TableSetupColumn("Last (ms)");
+        ImGui::TableSetupColumn("Avg (ms)");
+        ImGui::TableHeadersRow();
+        for (const GpuPassTiming &pass : GpuProfiler::get_passes()) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(pass.name);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", pass.last_ms);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", pass.average_ms);
+        }
+        ImGui::EndTable();
+    }
+    ImGui::Text("GPU frame: %.3f ms", GpuProfiler::get_last_frame_ms());
+}
+
+// One lane per thread, zones stacked by depth across the last whole frame.
+void EngineCore::draw_profiler_timeline() {
+    bool enabled = Profiler::is_enabled();
+    if (ImGui::Checkbox("Enabled", &enabled)) Profiler::set_enabled(enabled);
+    ImGui::SameLine();
+    ImGui::Checkbox("Pause", &profiler_paused);
+    ImGui::SameLine();
+    if (ImGui::Button("Export Chrome Trace") && Profiler::write_chrome_trace(config.profile_trace_path)) {
+        std::cout << "Profiler: wrote " << config.profile_trace_path << "\n";
+    }
+
+    uint64_t start_ns, end_ns;
+    if (!profiler_paused && Profiler::get_last_frame(start_ns, end_ns)) {
+        profiler_frame = Profiler::capture(start_ns, end_ns);
+        profiler_frame_start = start_ns;
+        profiler_frame_end = end_ns;
+    }
+    if (profiler_frame_end <= profiler_frame_start) {
+        ImGui::TextDisabled("No frame captured yet");
+        return;
+    }
+
+    ImGui::Text("Frame: %.2f ms", (profiler_frame_end - profiler_frame_start) / 1e6);
+
+    const float row_height = ImGui::GetTextLineHeightWithSpacing();
+    const float width = std::max(ImGui::GetContentRegionAvail().x, 200.0f);
+    const double ns_per_pixel = static_cast<double>(profiler_frame_end - profiler_frame_start) / width;
+    const ImVec2 mouse = ImGui::GetIO().MousePos;
+    ImDrawList *draw_list = ImGui::GetWindowDrawList();
+
+    for (const ProfileThread &thread : profiler_frame) {
+        uint32_t max_depth = 0;
+        for (const ProfileZone &zone : thread.zones) max_depth = std::max(max_depth, zone.depth);
+
+        ImGui::TextUnformatted(thread.name.c_str());
+        const ImVec2 origin = ImGui::GetCursorScreenPos();
+        ImGui::InvisibleButton(("##profiler_thread_" + std::to_string(thread.id)).c_str(), ImVec2(width, (max_depth + 1) * row_height));
+        const bool hovered = ImGui::IsItemHovered();
+
+        for (const ProfileZone &zone : thread.zones) {
+            const uint64_t zone_start = std::max(zone.start_ns, profiler_frame_start);
+            const uint64_t zone_end = std::min(zone.end_ns, profiler_frame_end);
+            const float x0 = origin.x + static_cast<float>((zone_start - profiler_frame_start) / ns_per_pixel);
+            const float x1 = std::max(x0 + 1.0f, origin.x + static_cast<float>((zone_end - profiler_frame_start) / ns_per_pixel));
+            const float y0 = origin.y + zone.depth * row_height;
+            const float y1 = y0 + row_height - 1.0f;
+
+            // Same name, same color, frame to frame.
+            const float hue = static_cast<float>(std::hash<std::string_view>{}(zone.name) % 64) / 64.0f;
+            draw_list->AddRectFilled(ImVec2(x0, y0), ImVec2(x1, y1), ImColor::HSV(hue, 0.5f, 0.7f));
+            if (x1 - x0 > ImGui::CalcTextSize(zone.name).x + 4.0f) {
+                draw_list->AddText(ImVec2(x0 + 2.0f, y0), IM_COL32_WHITE, zone.name);
+            }
+            if (hovered && mouse.x >= x0 && mouse.x < x1 && mouse.y >= y0 && mouse.y < y1) {
+                ImGui::SetTooltip("%s: %.3f ms", zone.name, (zone.end_ns - zone.start_ns) / 1e6);
+            }
+        }
+    }
+}
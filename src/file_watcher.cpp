@@ -0,0 +1,94 @@
+#include "file_watcher.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+FileWatcher::FileWatcher() {
+#ifdef __linux__
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) {
+        std::cerr << "FileWatcher: inotify unavailable, polling modification times\n";
+    }
+#endif
+}
+
+FileWatcher::~FileWatcher() {
+#ifdef __linux__
+    if (inotify_fd >= 0) close(inotify_fd);
+#endif
+}
+
+std::string FileWatcher::normalize(const std::string &path) {
+    return std::filesystem::path(path).lexically_normal().generic_string();
+}
+
+void FileWatcher::watch(const std::string &path) {
+    const std::string key = normalize(path);
+    if (files.count(key)) return;
+
+    std::error_code error;
+    files[key] = std::filesystem::last_write_time(key, error);
+
+#ifdef __linux__
+    if (inotify_fd < 0) return;
+    std::string directory = std::filesystem::path(key).parent_path().generic_string();
+    if (directory.empty()) directory = ".";
+    for (const auto &[descriptor, watched] : directories) {
+        if (watched == directory) return;
+    }
+
+    // Closed after writing, or renamed into place.
+    const int descriptor = inotify_add_watch(inotify_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (descriptor < 0) {
+        std::cerr << "FileWatcher: cannot watch " << directory << "\n";
+        return;
+    }
+    directories[descriptor] = directory;
+#endif
+}
+
+std::vector<std::string> FileWatcher::poll() {
+    std::vector<std::string> changed;
+
+#ifdef __linux__
+    if (inotify_fd >= 0) {
+        alignas(inotify_event) char buffer[4096];
+        while (true) {
+            const ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+            if (length <= 0) break; // EAGAIN: nothing left
+
+            for (ssize_t offset = 0; offset < length;) {
+                const auto *event = reinterpret_cast<const inotify_event *>(buffer + offset);
+                offset += sizeof(inotify_event) + event->len;
+
+                auto directory = directories.find(event->wd);
+                if (directory == directories.end() || event->len == 0) continue;
+                const std::string path = normalize(directory->second + "/" + event->name);
+                if (files.count(path) && std::find(changed.begin(), changed.end(), path) == changed.end()) {
+                    changed.push_back(path);
+                }
+            }
+        }
+        return changed;
+    }
+#endif
+
+    const auto now = std::chrono::steady_clock::now();
+    if (now - last_poll < poll_interval) return changed;
+    last_poll = now;
+
+    for (auto &[path, write_time] : files) {
+        std::error_code error;
+        const auto current = std::filesystem::last_write_time(path, error);
+        if (error || current == write_time) continue;
+        write_time = current;
+        changed.push_back(path);
+    }
+    return changed;
+}
@@ -0,0 +1,71 @@
+#include "frame_time_tracker.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+void FrameTimeTracker::Ring::push(float value) {
+    values[next] = value;
+    next = (next + 1) % history_size;
+    count = std::min(count + 1, history_size);
+}
+
+std::vector<float> FrameTimeTracker::Ring::get_ordered() const {
+    std::vector<float> ordered;
+    ordered.reserve(count);
+    const size_t first = (next + history_size - count) % history_size;
+    for (size_t i = 0; i < count; ++i) ordered.push_back(values[(first + i) % history_size]);
+    return ordered;
+}
+
+// Nearest-rank percentiles over the frames in the ring.
+FrameTimeTracker::Percentiles FrameTimeTracker::get_percentiles(const Ring &ring) {
+    Percentiles percentiles;
+    if (ring.count == 0) return percentiles;
+
+    std::vector<float> sorted(ring.values.begin(), ring.values.begin() + static_cast<ptrdiff_t>(ring.count));
+    std::sort(sorted.begin(), sorted.end());
+    auto rank = [&](double fraction) {
+        const size_t index = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+        return sorted[std::clamp<size_t>(index, 1, sorted.size()) - 1];
+    };
+
+    percentiles.p50 = rank(0.50);
+    percentiles.p95 = rank(0.95);
+    percentiles.p99 = rank(0.99);
+    percentiles.max = sorted.back();
+    return percentiles;
+}
+
+uint64_t FrameTimeTracker::add_cpu_frame(float ms, float budget_ms) {
+    cpu_ms.push(ms);
+    if (ms > budget_ms) hitch_count++;
+    if (keep_all) all_cpu_ms.push_back(ms);
+    return frame_count++;
+}
+
+void FrameTimeTracker::add_gpu_frame(uint64_t frame, float ms) {
+    gpu_ms.push(ms);
+    if (!keep_all || frame >= all_cpu_ms.size()) return;
+    if (all_gpu_ms.size() <= frame) all_gpu_ms.resize(static_cast<size_t>(frame) + 1, -1.0f);
+    all_gpu_ms[static_cast<size_t>(frame)] = ms;
+}
+
+bool FrameTimeTracker::write_csv(const std::string &path) const {
+    if (all_cpu_ms.empty()) return false;
+
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        std::cerr << "FrameTimeTracker: failed to write " << path << "\n";
+        return false;
+    }
+
+    file << "frame,cpu_ms,gpu_ms\n";
+    for (size_t frame = 0; frame < all_cpu_ms.size(); ++frame) {
+        file << frame << "," << all_cpu_ms[frame] << ",";
+        if (frame < all_gpu_ms.size() && all_gpu_ms[frame] >= 0.0f) file << all_gpu_ms[frame];
+        file << "\n";
+    }
+    return bool(file);
+}
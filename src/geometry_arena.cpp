@@ -0,0 +1,242 @@
+#include "geometry_arena.hpp"
+#include "render_stats.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+    constexpr GLuint initial_vertex_capacity = 1 << 16;
+    constexpr GLuint initial_index_capacity = 1 << 18;
+
+    GLsizei vertex_stride_of(VertexFormat format) {
+        switch (format) {
+            case VertexFormat::Standard: return sizeof(StandardVertex);
+            default: return 0;
+        }
+    }
+
+    // Copies the first used_bytes of buffer into a new buffer of new_bytes.
+    GLuint reallocate_buffer(GLuint buffer, GLsizeiptr used_bytes, GLsizeiptr new_bytes) {
+        GLuint new_buffer = 0;
+        glGenBuffers(1, &new_buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, new_buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, new_bytes, nullptr, GL_STATIC_DRAW);
+
+        if (buffer && used_bytes > 0) {
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used_bytes);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        if (buffer) glDeleteBuffers(1, &buffer);
+        return new_buffer;
+    }
+}
+
+////////////////////
+// RangeAllocator //
+////////////////////
+
+bool RangeAllocator::allocate(GLuint count, GLuint &offset) {
+    for (auto it = free_ranges.begin(); it != free_ranges.end(); ++it) {
+        if (it->count < count) continue;
+
+        offset = it->offset;
+        it->offset += count;
+        it->count -= count;
+        if (it->count == 0) free_ranges.erase(it);
+
+        used += count;
+        return true;
+    }
+    return false;
+}
+
+void RangeAllocator::free(GLuint offset, GLuint count) {
+    if (count == 0) return;
+
+    auto next = std::lower_bound(free_ranges.begin(), free_ranges.end(), offset,
+        [](const Range &range, GLuint value) { return range.offset < value; });
+    auto it = free_ranges.insert(next, {offset, count});
+    used -= count;
+
+    // Merge with the following range, then with the preceding one.
+    auto following = it + 1;
+    if (following != free_ranges.end() && it->offset + it->count == following->offset) {
+        it->count += following->count;
+        free_ranges.erase(following);
+    }
+    if (it != free_ranges.begin()) {
+        auto preceding = it - 1;
+        if (preceding->offset + preceding->count == it->offset) {
+            preceding->count += it->count;
+            free_ranges.erase(it);
+        }
+    }
+}
+
+void RangeAllocator::grow(GLuint new_capacity) {
+    if (new_capacity <= capacity) return;
+
+    const GLuint added = new_capacity - capacity;
+    const GLuint old_capacity = capacity;
+    capacity = new_capacity;
+
+    // Hand the new tail to free() so it merges with a free range ending at the old capacity.
+    used += added;
+    free(old_capacity, added);
+}
+
+///////////////////
+// GeometryArena //
+///////////////////
+
+std::array<std::unique_ptr<GeometryArena>, static_cast<size_t>(VertexFormat::Count)> GeometryArena::arenas;
+
+GeometryArena::GeometryArena(VertexFormat format)
+    : format(format), vertex_stride(vertex_stride_of(format)) {
+    create_buffers();
+}
+
+GeometryArena::~GeometryArena() {
+    if (!vao) return;
+
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &ebo);
+}
+
+GeometryArena &GeometryArena::get(VertexFormat format) {
+    auto &arena = arenas[static_cast<size_t>(format)];
+    if (!arena) arena.reset(new GeometryArena(format));
+    return *arena;
+}
+
+GeometryArena *GeometryArena::find(VertexFormat format) {
+    return arenas[static_cast<size_t>(format)].get();
+}
+
+void GeometryArena::shutdown_all() {
+    for (auto &arena : arenas) arena.reset();
+}
+
+void GeometryArena::create_buffers() {
+    glGenVertexArrays(1, &vao);
+
+    vbo = reallocate_buffer(0, 0, static_cast<GLsizeiptr>(initial_vertex_capacity) * vertex_stride);
+    ebo = reallocate_buffer(0, 0, static_cast<GLsizeiptr>(initial_index_capacity) * sizeof(GLuint));
+    vertex_ranges.grow(initial_vertex_capacity);
+    index_ranges.grow(initial_index_capacity);
+
+    set_vertex_attributes();
+}
+
+// Points the VAO at the current vbo/ebo; rerun whenever either is reallocated.
+void GeometryArena::set_vertex_attributes() {
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+    switch (format) {
+        case VertexFormat::Standard:
+            // position
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, vertex_stride, (void*)offsetof(StandardVertex, position));
+            glEnableVertexAttribArray(0);
+
+            // normal
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, vertex_stride, (void*)offsetof(StandardVertex, normal));
+            glEnableVertexAttribArray(1);
+
+            // tangent
+            glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, vertex_stride, (void*)offsetof(StandardVertex, tangent));
+            glEnableVertexAttribArray(2);
+
+            // uv0
+            glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, vertex_stride, (void*)offsetof(StandardVertex, uv0));
+            glEnableVertexAttribArray(3);
+
+            // uv1
+            glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, vertex_stride, (void*)offsetof(StandardVertex, uv1));
+            glEnableVertexAttribArray(4);
+            break;
+        default:
+            break;
+    }
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GeometryArena::grow_vertex_buffer(GLuint min_capacity) {
+    GLuint new_capacity = std::max(vertex_ranges.get_capacity(), 1u);
+    while (new_capacity < min_capacity) new_capacity *= 2;
+
+    vbo = reallocate_buffer(vbo,
+        static_cast<GLsizeiptr>(vertex_ranges.get_capacity()) * vertex_stride,
+        static_cast<GLsizeiptr>(new_capacity) * vertex_stride);
+    vertex_ranges.grow(new_capacity);
+    set_vertex_attributes();
+}
+
+void GeometryArena::grow_index_buffer(GLuint min_capacity) {
+    GLuint new_capacity = std::max(index_ranges.get_capacity(), 1u);
+    while (new_capacity < min_capacity) new_capacity *= 2;
+
+    ebo = reallocate_buffer(ebo,
+        static_cast<GLsizeiptr>(index_ranges.get_capacity()) * sizeof(GLuint),
+        static_cast<GLsizeiptr>(new_capacity) * sizeof(GLuint));
+    index_ranges.grow(new_capacity);
+    set_vertex_attributes();
+}
+
+bool GeometryArena::allocate(const void *vertex_data, GLuint vertex_count, const GLuint *index_data, GLuint index_count, GeometryAllocation &allocation) {
+    GLuint vertex_offset = 0;
+    if (!vertex_ranges.allocate(vertex_count, vertex_offset)) {
+        grow_vertex_buffer(vertex_ranges.get_capacity() + vertex_count);
+        if (!vertex_ranges.allocate(vertex_count, vertex_offset)) {
+            std::cerr << "GeometryArena: unable to allocate " << vertex_count << " vertices\n";
+            return false;
+        }
+    }
+
+    GLuint index_offset = 0;
+    if (!index_ranges.allocate(index_count, index_offset)) {
+        grow_index_buffer(index_ranges.get_capacity() + index_count);
+        if (!index_ranges.allocate(index_count, index_offset)) {
+            std::cerr << "GeometryArena: unable to allocate " << index_count << " indices\n";
+            vertex_ranges.free(vertex_offset, vertex_count);
+            return false;
+        }
+    }
+
+    // COPY_WRITE leaves the element binding of whatever VAO is bound untouched.
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER,
+        static_cast<GLintptr>(vertex_offset) * vertex_stride,
+        static_cast<GLsizeiptr>(vertex_count) * vertex_stride,
+        vertex_data);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER,
+        static_cast<GLintptr>(index_offset) * sizeof(GLuint),
+        static_cast<GLsizeiptr>(index_count) * sizeof(GLuint),
+        index_data);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    render_stats.buffer_upload_bytes += static_cast<uint64_t>(vertex_count) * vertex_stride + static_cast<uint64_t>(index_count) * sizeof(GLuint);
+
+    allocation = {static_cast<GLint>(vertex_offset), index_offset, vertex_count, index_count};
+    return true;
+}
+
+// CPU-side bookkeeping only, so it is safe after shutdown_all.
+void GeometryArena::free(const GeometryAllocation &allocation) {
+    vertex_ranges.free(static_cast<GLuint>(allocation.base_vertex), allocation.vertex_count);
+    index_ranges.free(allocation.first_index, allocation.index_count);
+}
+
+void GeometryArena::bind() const {
+    glBindVertexArray(vao);
+    render_stats.vertex_array_binds++;
+}
@@ -0,0 +1,81 @@
+#include "gl_extensions.hpp"
+
+#include <iostream>
+
+GLExtensions gl_extensions;
+
+bool GLExtensions::has_extension(const std::string &name) const {
+    GLint extension_count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+    for (GLint i = 0; i < extension_count; ++i) {
+        const char *extension = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension && name == extension) return true;
+    }
+    return false;
+}
+
+bool GLExtensions::is_version_at_least(GLint major, GLint minor) const {
+    return major_version > major || (major_version == major && minor_version >= minor);
+}
+
+bool load_gl_extensions(GLADloadproc load) {
+    glGetIntegerv(GL_MAJOR_VERSION, &gl_extensions.major_version);
+    glGetIntegerv(GL_MINOR_VERSION, &gl_extensions.minor_version);
+
+    if (gl_extensions.is_version_at_least(4, 3) ||
+        (gl_extensions.has_extension("GL_ARB_multi_draw_indirect") && gl_extensions.has_extension("GL_ARB_base_instance"))) {
+        gl_extensions.multi_draw_elements_indirect = reinterpret_cast<PFNGLMULTIDRAWELEMENTSINDIRECTPROC_EXT>(load("glMultiDrawElementsIndirect"));
+        gl_extensions.multi_draw_indirect = gl_extensions.multi_draw_elements_indirect != nullptr;
+    }
+
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &gl_extensions.uniform_buffer_offset_alignment);
+
+    gl_extensions.texture_compression_s3tc = gl_extensions.has_extension("GL_EXT_texture_compression_s3tc");
+    gl_extensions.texture_compression_bptc = gl_extensions.is_version_at_least(4, 2) ||
+                                             gl_extensions.has_extension("GL_ARB_texture_compression_bptc");
+
+    gl_extensions.texture_filter_anisotropic = gl_extensions.is_version_at_least(4, 6) ||
+                                               gl_extensions.has_extension("GL_ARB_texture_filter_anisotropic") ||
+                                               gl_extensions.has_extension("GL_EXT_texture_filter_anisotropic");
+    if (gl_extensions.texture_filter_anisotropic) {
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &gl_extensions.max_anisotropy);
+    }
+
+    if (gl_extensions.is_version_at_least(4, 1) || gl_extensions.has_extension("GL_ARB_get_program_binary")) {
+        gl_extensions.get_program_binary = reinterpret_cast<PFNGLGETPROGRAMBINARYPROC_EXT>(load("glGetProgramBinary"));
+        gl_extensions.program_binary_load = reinterpret_cast<PFNGLPROGRAMBINARYPROC_EXT>(load("glProgramBinary"));
+        gl_extensions.program_parameteri = reinterpret_cast<PFNGLPROGRAMPARAMETERIPROC_EXT>(load("glProgramParameteri"));
+        GLint format_count = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+        gl_extensions.program_binary = format_count > 0 && gl_extensions.get_program_binary &&
+                                       gl_extensions.program_binary_load && gl_extensions.program_parameteri;
+    }
+
+    std::cout << "GL " << gl_extensions.major_version << "." << gl_extensions.minor_version
+              << ", multi-draw indirect: " << (gl_extensions.multi_draw_indirect ? "yes" : "no")
+              << ", S3TC: " << (gl_extensions.texture_compression_s3tc ? "yes" : "no")
+              << ", BPTC: " << (gl_extensions.texture_compression_bptc ? "yes" : "no")
+              << ", max anisotropy: " << gl_extensions.max_anisotropy
+              << ", program binaries: " << (gl_extensions.program_binary ? "yes" : "no") << "\n";
+    return true;
+}
+
+bool is_block_format_supported(BlockFormat format) {
+    switch (format) {
+        case BlockFormat::BC1:
+        case BlockFormat::BC3: return gl_extensions.texture_compression_s3tc;
+        case BlockFormat::BC5: return true; // RGTC is core since GL 3.0
+        case BlockFormat::BC7: return gl_extensions.texture_compression_bptc;
+    }
+    return false;
+}
+
+GLenum get_gl_internal_format(BlockFormat format, bool srgb) {
+    switch (format) {
+        case BlockFormat::BC1: return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case BlockFormat::BC3: return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case BlockFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+        case BlockFormat::BC7: return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include "gpu_profiler.hpp"
+#include "engine_config.hpp"
+
+#include <cstring>
+
+namespace {
+    // Frames whose results are still out after this many are dropped rather
+    // than waited for.
+    const size_t max_pending_frames = 8;
+    const double average_weight = 1.0 / 30.0;
+}
+
+bool GpuProfiler::supported = false;
+bool GpuProfiler::in_frame = false;
+bool GpuProfiler::pass_open = false;
+std::vector<GLuint> GpuProfiler::free_queries;
+std::deque<GpuProfiler::PendingFrame> GpuProfiler::pending_frames;
+std::vector<GpuPassTiming> GpuProfiler::passes;
+double GpuProfiler::last_frame_ms = 0.0;
+uint64_t GpuProfiler::completed_frames = 0;
+std::vector<std::pair<uint64_t, double>> GpuProfiler::newly_completed;
+
+void GpuProfiler::initialize() {
+    supported = false;
+    if (!glGenQueries || !glGetQueryiv || !glGetQueryObjectui64v) return;
+
+    GLint counter_bits = 0;
+    glGetQueryiv(GL_TIME_ELAPSED, GL_QUERY_COUNTER_BITS, &counter_bits);
+    supported = counter_bits > 0;
+}
+
+size_t GpuProfiler::get_pass_index(const char *name) {
+    for (size_t i = 0; i < passes.size(); ++i) {
+        if (passes[i].name == name || std::strcmp(passes[i].name, name) == 0) return i;
+    }
+    passes.push_back({name});
+    return passes.size() - 1;
+}
+
+// Takes in every finished frame, oldest first, stopping at the first one
+// the GPU is still working on.
+void GpuProfiler::read_back() {
+    while (!pending_frames.empty()) {
+        PendingFrame &frame = pending_frames.front();
+        for (const auto &[pass_index, query] : frame.queries) {
+            GLint available = 0;
+            glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) return;
+        }
+
+        // A pass can run more than once in a frame (one flush per camera).
+        std::vector<double> frame_ms(passes.size(), 0.0);
+        for (const auto &[pass_index, query] : frame.queries) {
+            GLuint64 elapsed_ns = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed_ns);
+            frame_ms[pass_index] += elapsed_ns / 1e6;
+            free_queries.push_back(query);
+        }
+
+        last_frame_ms = 0.0;
+        for (size_t i = 0; i < passes.size(); ++i) {
+            GpuPassTiming &pass = passes[i];
+            pass.last_ms = frame_ms[i];
+            pass.average_ms = completed_frames == 0 ? pass.last_ms : pass.average_ms + (pass.last_ms - pass.average_ms) * average_weight;
+            last_frame_ms += pass.last_ms;
+        }
+        completed_frames++;
+        newly_completed.push_back({frame.frame, last_frame_ms});
+        pending_frames.pop_front();
+    }
+}
+
+void GpuProfiler::begin_frame(uint64_t frame) {
+    in_frame = false;
+    newly_completed.clear();
+    if (!supported || !config.gpu_timing) return;
+
+    read_back();
+    while (pending_frames.size() >= max_pending_frames) {
+        for (const auto &[pass_index, query] : pending_frames.front().queries) glDeleteQueries(1, &query);
+        pending_frames.pop_front();
+    }
+
+    pending_frames.push_back({frame, {}});
+    in_frame = true;
+}
+
+void GpuProfiler::end_frame() {
+    end_pass();
+    in_frame = false;
+}
+
+void GpuProfiler::begin_pass(const char *name) {
+    if (!in_frame) return;
+    end_pass();
+
+    GLuint query = 0;
+    if (!free_queries.empty()) {
+        query = free_queries.back();
+        free_queries.pop_back();
+    } else {
+        glGenQueries(1, &query);
+    }
+
+    pending_frames.back().queries.push_back({get_pass_index(name), query});
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    pass_open = true;
+}
+
+void GpuProfiler::end_pass() {
+    if (!pass_open) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    pass_open = false;
+}
+
+void GpuProfiler::shutdown() {
+    end_frame();
+    for (const PendingFrame &frame : pending_frames) {
+        for (const auto &[pass_index, query] : frame.queries) glDeleteQueries(1, &query);
+    }
+    if (!free_queries.empty()) glDeleteQueries(static_cast<GLsizei>(free_queries.size()), free_queries.data());
+    pending_frames.clear();
+    free_queries.clear();
+}
@@ -0,0 +1,120 @@
+#include "lz4_block.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    constexpr size_t min_match = 4;
+    constexpr size_t last_literals = 5;    // the block always ends in at least this many literals
+    constexpr size_t match_start_limit = 12; // and no match starts in its last 12 bytes
+    constexpr size_t max_offset = 65535;
+    constexpr int hash_bits = 12;
+
+    uint32_t read32(const uint8_t *bytes) {
+        uint32_t value;
+        std::memcpy(&value, bytes, sizeof(value));
+        return value;
+    }
+
+    uint32_t hash_sequence(uint32_t sequence) {
+        return (sequence * 2654435761u) >> (32 - hash_bits);
+    }
+
+    // Lengths that do not fit the token's 4 bits continue in bytes of 255 and a remainder.
+    void write_length(std::vector<uint8_t> &out, size_t length) {
+        for (; length >= 255; length -= 255) out.push_back(255);
+        out.push_back(static_cast<uint8_t>(length));
+    }
+
+    bool read_length(const uint8_t *source, size_t source_size, size_t &position, size_t &length) {
+        uint8_t byte;
+        do {
+            if (position >= source_size) return false;
+            byte = source[position++];
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    void write_sequence(std::vector<uint8_t> &out, const uint8_t *literals, size_t literal_length, size_t offset, size_t match_length) {
+        const size_t match_code = match_length >= min_match ? match_length - min_match : 0;
+        out.push_back(static_cast<uint8_t>((std::min<size_t>(literal_length, 15) << 4) |
+                                           (match_length ? std::min<size_t>(match_code, 15) : 0)));
+        if (literal_length >= 15) write_length(out, literal_length - 15);
+        out.insert(out.end(), literals, literals + literal_length);
+        if (!match_length) return;
+
+        out.push_back(static_cast<uint8_t>(offset & 0xFF));
+        out.push_back(static_cast<uint8_t>(offset >> 8));
+        if (match_code >= 15) write_length(out, match_code - 15);
+    }
+}
+
+std::vector<uint8_t> lz4_compress(const uint8_t *source, size_t size) {
+    std::vector<uint8_t> out;
+    out.reserve(size / 2 + 16);
+
+    // Last position + 1 each 4-byte sequence was seen at; 0 for none.
+    std::vector<uint32_t> table(size_t(1) << hash_bits, 0);
+
+    size_t anchor = 0;
+    size_t position = 0;
+    if (size > match_start_limit) {
+        const size_t limit = size - match_start_limit;
+        while (position < limit) {
+            const uint32_t sequence = read32(source + position);
+            uint32_t &slot = table[hash_sequence(sequence)];
+            const size_t candidate = slot;
+            slot = static_cast<uint32_t>(position + 1);
+
+            if (!candidate || position - (candidate - 1) > max_offset || read32(source + candidate - 1) != sequence) {
+                ++position;
+                continue;
+            }
+
+            const size_t match = candidate - 1;
+            size_t length = min_match;
+            while (position + length < size - last_literals && source[match + length] == source[position + length]) ++length;
+
+            write_sequence(out, source + anchor, position - anchor, position - match, length);
+            position += length;
+            anchor = position;
+        }
+    }
+
+    write_sequence(out, source + anchor, size - anchor, 0, 0);
+    return out;
+}
+
+bool lz4_decompress(const uint8_t *source, size_t source_size, uint8_t *destination, size_t destination_size) {
+    size_t in = 0;
+    size_t out = 0;
+    while (in < source_size) {
+        const uint8_t token = source[in++];
+
+        size_t literal_length = token >> 4;
+        if (literal_length == 15 && !read_length(source, source_size, in, literal_length)) return false;
+        if (literal_length > source_size - in || literal_length > destination_size - out) return false;
+        std::memcpy(destination + out, source + in, literal_length);
+        in += literal_length;
+        out += literal_length;
+
+        if (in == source_size) break; // the last sequence has no match
+
+        if (source_size - in < 2) return false;
+        const size_t offset = source[in] | (size_t(source[in + 1]) << 8);
+        in += 2;
+        if (offset == 0 || offset > out) return false;
+
+        size_t match_length = token & 15;
+        if (match_length == 15 && !read_length(source, source_size, in, match_length)) return false;
+        match_length += min_match;
+        if (match_length > destination_size - out) return false;
+
+        // Byte by byte: the match may overlap what it is copying.
+        const uint8_t *match = destination + out - offset;
+        for (size_t i = 0; i < match_length; ++i) destination[out + i] = match[i];
+        out += match_length;
+    }
+    return out == destination_size;
+}
@@ -1,67 +1,264 @@
 #include "material.hpp"
+#include "utils.hpp"
+#include "render_stats.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 
 namespace {
     void log_uniform_not_found(const std::string& name) {
         std::cerr << "Material: Uniform '" << name << "' not found in shader program.\n";
     }
+
+    // "normal_map" -> "USE_NORMAL_MAP"
+    std::string get_texture_keyword(const std::string &name) {
+        std::string keyword = "USE_" + name.substr(name.find_last_of('.') + 1);
+        std::transform(keyword.begin(), keyword.end(), keyword.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+        return keyword;
+    }
+
+    uint64_t hash_entry(const std::string &name, const void *value, size_t size) {
+        return hash_bytes(value, size, hash_bytes(name.data(), name.size()));
+    }
+
+    bool is_sampler_type(GLenum type) {
+        switch (type) {
+            case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+            case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_BUFFER:
+                return true;
+            default:
+                return false;
+        }
+    }
 }
 
 //////////////////////////////
 // Shader/Uniform Functions //
 //////////////////////////////
 
+Material::~Material() {
+    if (parameter_buffer) glDeleteBuffers(1, &parameter_buffer);
+}
+
 // Associates a shader with the material and resets texture unit assignment.
 void Material::set_shader(std::shared_ptr<Shader> shader) {
     this->shader = shader;
+    variant = 0;
+    program = shader ? shader->get_program() : 0;
+    shader_generation = shader ? shader->get_generation() : 0;
     next_texture_unit = 0;
+    sampler_units.clear();
+    assign_sampler_units();
+    adopt_layout(shader ? shader->get_layout(0) : std::make_shared<ParameterLayout>());
 }
 
-// set float uniform; Logs error if not found.
-bool Material::set_uniform(const std::string &name, float value) {
-    GLuint location = glGetUniformLocation(shader->get_program(), name.c_str());
-    if (location == static_cast<GLuint>(-1)) {
+// Gives each sampler of the program a unit of its own; names that already
+// have one keep it, so variants of one shader agree on units.
+void Material::assign_sampler_units() {
+    if (!program) return;
+
+    for (auto &[name, sampler_unit] : sampler_units) {
+        sampler_unit.location = glGetUniformLocation(program, name.c_str());
+    }
+
+    GLint uniform_count = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniform_count);
+    for (GLint i = 0; i < uniform_count; ++i) {
+        char name[256];
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(program, static_cast<GLuint>(i), sizeof(name), nullptr, &size, &type, name);
+        if (!is_sampler_type(type) || sampler_units.count(name)) continue;
+        sampler_units[name] = {static_cast<GLuint>(glGetUniformLocation(program, name)), next_texture_unit++};
+    }
+}
+
+int Material::get_sampler_unit(const std::string &name) {
+    auto it = sampler_units.find(name);
+    return it != sampler_units.end() ? it->second.unit : next_texture_unit++;
+}
+
+bool Material::set_keyword(const std::string &keyword, bool enabled) {
+    const int index = shader ? shader->get_keyword_index(keyword) : -1;
+    if (index < 0) {
+        std::cerr << "Material: shader has no keyword " << keyword << "\n";
+        return false;
+    }
+    const uint32_t bit = 1u << index;
+    select_variant(enabled ? variant | bit : variant & ~bit);
+    return true;
+}
+
+void Material::enable_texture_keyword(const std::string &name, bool enabled) {
+    const int index = shader ? shader->get_keyword_index(get_texture_keyword(name)) : -1;
+    if (index < 0) return;
+    const uint32_t bit = 1u << index;
+    select_variant(enabled ? variant | bit : variant & ~bit);
+}
+
+// Uniform values are kept by name, so only their locations change with the program.
+void Material::select_variant(uint32_t new_variant) {
+    if (new_variant == variant) return;
+    const GLuint new_program = shader->get_program(new_variant);
+    if (!new_program) {
+        std::cerr << "Material: shader variant " << new_variant << " failed to build, keeping " << variant << "\n";
+        return;
+    }
+
+    variant = new_variant;
+    program = new_program;
+    adopt_layout(shader->get_layout(variant));
+    resolve_locations();
+}
+
+// Carries parameter values, and which of them instances override, over by
+// name when the program, and with it the layout, changes.
+void Material::adopt_layout(std::shared_ptr<const ParameterLayout> new_layout) {
+    parameters.set_layout(std::move(new_layout), static_cast<size_t>(std::max(1, gl_extensions.uniform_buffer_offset_alignment)));
+}
+
+// Writing slot 0 also writes every instance slot that does not override the parameter.
+bool Material::set_parameter(uint32_t slot, const std::string &name, GLenum type, const void *value) {
+    const ParameterLayout &layout = parameters.get_layout();
+    const ParameterLayout::Parameter *parameter = layout.find(name);
+    if (!parameter) {
         log_uniform_not_found(name);
         return false;
     }
+    if (parameter->type != type) {
+        std::cerr << "Material: Uniform '" << name << "' has a different type in the shader.\n";
+        return false;
+    }
+    if (slot != 0 && static_cast<size_t>(parameter - layout.parameters.data()) >= ParameterBlock::max_overrides) {
+        std::cerr << "Material: only the first " << ParameterBlock::max_overrides << " parameters can be overridden per instance, not '" << name << "'\n";
+        return false;
+    }
 
-    uniforms[name] = {location, value}; 
+    parameters.set(slot, *parameter, value);
     return true;
 }
 
-// set glm::vec3 uniform; Logs error if not found.
-bool Material::set_uniform(const std::string& name, glm::vec3 value) {
-    GLuint location = glGetUniformLocation(shader->get_program(), name.c_str());
-    if (location == static_cast<GLuint>(-1)) {
+bool Material::reset_parameter(uint32_t slot, const std::string &name) {
+    const ParameterLayout::Parameter *parameter = parameters.get_layout().find(name);
+    if (!parameter) {
         log_uniform_not_found(name);
         return false;
     }
-    uniforms[name] = {location, value}; 
+    parameters.reset(slot, *parameter);
     return true;
 }
 
-// set glm::mat4 uniform; logs errors if not found.
+void Material::resolve_locations() {
+    for (auto &[name, texture_uniform] : texture_uniforms) texture_uniform.location = glGetUniformLocation(program, name.c_str());
+    for (auto &[name, layer_uniform] : texture_layer_uniforms) layer_uniform.location = glGetUniformLocation(program, name.c_str());
+    assign_sampler_units();
+}
+
+// Follows a hot-reloaded shader to the new program for the current variant.
+void Material::refresh_program() {
+    shader_generation = shader->get_generation();
+    const GLuint new_program = shader->get_program(variant);
+    if (!new_program) {
+        std::cerr << "Material: reloaded shader variant " << variant << " failed to build, keeping the old program\n";
+        return;
+    }
+    program = new_program;
+    adopt_layout(shader->get_layout(variant));
+    resolve_locations();
+}
+
+// set float parameter; Logs error if not found.
+bool Material::set_uniform(const std::string &name, float value) {
+    return set_parameter(0, name, GL_FLOAT, &value);
+}
+
+// set glm::vec3 parameter; Logs error if not found.
+bool Material::set_uniform(const std::string& name, glm::vec3 value) {
+    return set_parameter(0, name, GL_FLOAT_VEC3, glm::value_ptr(value));
+}
+
+// set glm::mat4 parameter; logs errors if not found.
 bool Material::set_uniform(const std::string& name, glm::mat4 value) {
-    GLuint location = glGetUniformLocation(shader->get_program(), name.c_str());
+    return set_parameter(0, name, GL_FLOAT_MAT4, glm::value_ptr(value));
+}
+
+// Sets a texture uniform, assigns it a texture unit automatically.
+bool Material::set_uniform(const std::string& name, std::shared_ptr<Texture> texture) {
+    enable_texture_keyword(name, texture != nullptr);
+    GLuint location = glGetUniformLocation(program, name.c_str());
     if (location == static_cast<GLuint>(-1)) {
         log_uniform_not_found(name);
         return false;
     }
-    uniforms[name] = {location, value}; 
+    SamplerSettings sampler = texture ? texture->get_settings().sampler : SamplerSettings();
+    texture_uniforms[name] = {location, texture, get_sampler_unit(name), sampler};
     return true;
 }
 
-// Sets a texture uniform, assigns it a texture unit automatically.
-bool Material::set_uniform(const std::string& name, std::shared_ptr<Texture> texture) {
-    GLuint location = glGetUniformLocation(shader->get_program(), name.c_str());
+// Overrides how a texture or packed texture uniform is sampled.
+bool Material::set_sampler(const std::string& name, const SamplerSettings &sampler) {
+    if (auto it = texture_uniforms.find(name); it != texture_uniforms.end()) {
+        it->second.sampler = sampler;
+        return true;
+    }
+    if (auto it = texture_layer_uniforms.find(name); it != texture_layer_uniforms.end()) {
+        it->second.sampler = sampler;
+        return true;
+    }
+    std::cerr << "Material: no texture uniform " << name << " to set a sampler on\n";
+    return false;
+}
+
+// Sets a sampler2DArray uniform to a packed texture's array.
+bool Material::set_uniform(const std::string& name, std::shared_ptr<TextureLayer> layer) {
+    enable_texture_keyword(name, layer != nullptr);
+    GLuint location = glGetUniformLocation(program, name.c_str());
     if (location == static_cast<GLuint>(-1)) {
         log_uniform_not_found(name);
         return false;
     }
-    int unit = next_texture_unit++;
-    texture_uniforms[name] = {location, texture, unit}; 
+    if (!texture_layer_uniforms.empty() && texture_layer_uniforms.find(name) == texture_layer_uniforms.end()) {
+        std::cerr << "Material: only one packed texture is supported, replacing it with " << name << "\n";
+        texture_layer_uniforms.clear();
+    }
+
+    // Packed regions must not wrap into their neighbours; the shader wraps within the rect.
+    SamplerSettings sampler;
+    sampler.wrap = GL_CLAMP_TO_EDGE;
+    texture_layer_uniforms[name] = {location, layer, get_sampler_unit(name), sampler};
     return true;
 }
 
+const TextureLayer *Material::get_texture_layer() const {
+    if (texture_layer_uniforms.empty()) return nullptr;
+    return texture_layer_uniforms.begin()->second.layer.get();
+}
+
+// Entries are combined with XOR so the unordered maps' iteration order does not matter.
+uint64_t Material::update_batch_key() {
+    if (shader && shader->get_generation() != shader_generation) refresh_program();
+
+    const int state[5] = {static_cast<int>(blend_mode), depth_test, depth_write, static_cast<int>(cull_mode), static_cast<int>(program)};
+    uint64_t key = hash_bytes(state, sizeof(state));
+
+    // Only the material's own values; instances keep its key and pass their own slot.
+    key ^= hash_bytes(parameters.get_data().data(), parameters.get_data().empty() ? 0 : parameters.get_layout().size);
+    for (const auto &[name, texture_uniform] : texture_uniforms) {
+        const Texture *texture = texture_uniform.texture.get();
+        const GLuint sampler = SamplerCache::get(texture_uniform.sampler);
+        key ^= hash_entry(name, &texture, sizeof(texture)) ^ hash_entry(name, &sampler, sizeof(sampler));
+    }
+    for (const auto &[name, layer_uniform] : texture_layer_uniforms) {
+        const TextureArray *array = layer_uniform.layer ? layer_uniform.layer->array.get() : nullptr;
+        const GLuint sampler = SamplerCache::get(layer_uniform.sampler);
+        key ^= hash_entry(name, &array, sizeof(array)) ^ hash_entry(name, &sampler, sizeof(sampler));
+    }
+
+    batch_key = key;
+    return key;
+}
+
 
 /////////////////////////////
 // Utility/Debug Functions //
@@ -96,7 +293,7 @@ std::string get_type_string(GLenum type) {
 // Prints all active uniforms in the shader for debugging purposes.
 void Material::print_all_uniforms() {
     GLint num_uniforms = 0;
-    glGetProgramiv(shader->get_program(), GL_ACTIVE_UNIFORMS, &num_uniforms);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &num_uniforms);
 
     std::cout << "Number of uniforms: " << num_uniforms << "\n";
 
@@ -105,7 +302,7 @@ void Material::print_all_uniforms() {
         GLsizei length;
         GLint size;
         GLenum type;
-        glGetActiveUniform(shader->get_program(), i, sizeof(name), &length, &size, &type, name);
+        glGetActiveUniform(program, i, sizeof(name), &length, &size, &type, name);
         std::cout << "Uniform #" << i << ": " << get_type_string(type) << " " << name << "\n";
     }
     std::cout << "\n";
@@ -114,27 +311,30 @@ void Material::print_all_uniforms() {
 // Checks that every active uniform in the shader has been set; logs warnings otherwise.
 void Material::check_uniforms() {
     GLint num_uniforms = 0;
-    glGetProgramiv(shader->get_program(), GL_ACTIVE_UNIFORMS, &num_uniforms);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &num_uniforms);
     std::unordered_map<std::string, std::pair<bool, GLenum>> uniform_set_map;
 
-    // build a map of shader uniforms.
+    // build a map of shader uniforms. Block members always have a value
+    // (the material's parameter block or RenderQueue's frame block).
     for (GLint i = 0; i < num_uniforms; i++) {
         char name[256];
         GLsizei length;
         GLint size;
         GLenum type;
-        glGetActiveUniform(shader->get_program(), i, sizeof(name), &length, &size, &type, name);
-        uniform_set_map[name] = {false, type};
+        glGetActiveUniform(program, i, sizeof(name), &length, &size, &type, name);
+
+        GLint block_index = -1;
+        const GLuint index = static_cast<GLuint>(i);
+        glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_BLOCK_INDEX, &block_index);
+        if (block_index < 0) uniform_set_map[name] = {false, type};
     }
 
-    // Mark uniforms set via the regular uniform map.
-    for (const auto& [name, uniform] : uniforms) {
+    for (const auto &[name, texture_uniform] : texture_uniforms) {
         if (uniform_set_map.find(name) != uniform_set_map.end()) {
             uniform_set_map[name].first = true;
         }
     }
-
-    for (const auto &[name, texture_uniform] : texture_uniforms) {
+    for (const auto &[name, layer_uniform] : texture_layer_uniforms) {
         if (uniform_set_map.find(name) != uniform_set_map.end()) {
             uniform_set_map[name].first = true;
         }
@@ -164,6 +364,41 @@ void Material::set_depth_test(bool enable) { depth_test = enable; }
 void Material::set_depth_write(bool enable) { depth_write = enable; }
 void Material::set_cull_mode(CullMode mode) { cull_mode = mode; }
 
+void Material::request_texture_resolution(float pixels) {
+    for (auto &[name, texture_uniform] : texture_uniforms) {
+        if (texture_uniform.texture) texture_uniform.texture->request_resolution(pixels);
+    }
+}
+
+// Uploads only the bytes written since the last upload; a parent change
+// rewrites every instance slot following it, so that range can span the block.
+void Material::upload_parameters() {
+    const std::vector<unsigned char> &data = parameters.get_data();
+    if (!parameters.is_dirty() || data.empty()) return;
+    if (!parameter_buffer) glGenBuffers(1, &parameter_buffer);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, parameter_buffer);
+    if (parameter_buffer_size != data.size()) {
+        glBufferData(GL_UNIFORM_BUFFER, data.size(), data.data(), GL_DYNAMIC_DRAW);
+        parameter_buffer_size = data.size();
+        render_stats.uniform_upload_bytes += data.size();
+    } else {
+        const size_t begin = parameters.get_dirty_begin();
+        glBufferSubData(GL_UNIFORM_BUFFER, begin, parameters.get_dirty_end() - begin, data.data() + begin);
+        render_stats.uniform_upload_bytes += parameters.get_dirty_end() - begin;
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    render_stats.uniform_uploads++;
+    parameters.clear_dirty();
+}
+
+void Material::bind_parameters(uint32_t window) const {
+    if (!parameter_buffer || !parameters.get_layout().size) return;
+    glBindBufferRange(GL_UNIFORM_BUFFER, Shader::material_block_binding, parameter_buffer,
+                      static_cast<GLintptr>(parameters.get_window_offset(window)), parameters.get_window_size());
+    render_stats.uniform_buffer_binds++;
+}
+
 // Applies the material: sets rendering states and updates all uniforms and textures.
 void Material::apply() {
     // Set blend mode. 
@@ -200,32 +435,29 @@ void Material::apply() {
             break;
     }
 
-    // Activate shader
-    shader->use();
-
-    // Upload regular uniforms.
-    for (const auto &[name, uniform] : uniforms) {
-        std::visit([&](auto &&value) {
-            using T = std::decay_t<decltype(value)>;
+    // Activate the selected variant
+    glUseProgram(program);
+    render_stats.material_applies++;
 
-            if constexpr (std::is_same_v<T, float>) {
-                glUniform1f(uniform.location, value);
+    bind_parameters(0);
 
-            } else if constexpr (std::is_same_v<T, glm::vec3>) {
-                glUniform3fv(uniform.location, 1, glm::value_ptr(value));
-
-            } else if constexpr (std::is_same_v<T, glm::mat4>) {
-                glUniformMatrix4fv(uniform.location, 1, GL_FALSE, glm::value_ptr(value));
-
-            }
-        }, uniform.value);
+    // Point every sampler at its unit, then bind the textures there.
+    for (const auto &[name, sampler_unit] : sampler_units) {
+        glUniform1i(sampler_unit.location, sampler_unit.unit);
     }
 
-    // Bind and update texture uniforms.
     for (const auto &[name, texture_uniform] : texture_uniforms) {
         glActiveTexture(GL_TEXTURE0 + texture_uniform.unit);
         texture_uniform.texture->bind();
-        glUniform1i(texture_uniform.location, texture_uniform.unit);
+        glBindSampler(texture_uniform.unit, SamplerCache::get(texture_uniform.sampler));
+        render_stats.texture_binds++;
+    }
+
+    for (const auto &[name, layer_uniform] : texture_layer_uniforms) {
+        if (!layer_uniform.layer || !layer_uniform.layer->is_ready()) continue;
+        layer_uniform.layer->array->bind(GL_TEXTURE0 + layer_uniform.unit);
+        glBindSampler(layer_uniform.unit, SamplerCache::get(layer_uniform.sampler));
+        render_stats.texture_binds++;
     }
 }
 
@@ -233,28 +465,41 @@ void Material::apply() {
 // ImGui Debug/Editor UI //
 ///////////////////////////
 
-// Displays and allows editing of uniforms via ImGui.
-// Displays and allows editing of uniforms via ImGui.
-void Material::draw_uniforms_gui() {
-    // Iterate over basic uniforms.
-    for (auto& [name, uniform] : uniforms) {
-        ImGui::Text("Uniform: %s", name.c_str());
-        if (std::holds_alternative<float>(uniform.value)) {
-            float& value = std::get<float>(uniform.value);
-            if (ImGui::SliderFloat(name.c_str(), &value, 0.0f, 1.0f)) {
-                set_uniform(name, value);
+// Edits one slot of the parameter block; instance slots can revert overrides.
+void Material::draw_parameters_gui(uint32_t slot) {
+    const ParameterLayout &layout = parameters.get_layout();
+    for (size_t index = 0; index < layout.parameters.size(); ++index) {
+        const ParameterLayout::Parameter &parameter = layout.parameters[index];
+        ImGui::PushID(static_cast<int>(index));
+        ImGui::Text("Uniform: %s", parameter.name.c_str());
+        const unsigned char *data = parameters.get(slot, parameter);
+        if (parameter.type == GL_FLOAT) {
+            float value;
+            std::memcpy(&value, data, sizeof(value));
+            if (ImGui::SliderFloat(parameter.name.c_str(), &value, 0.0f, 1.0f)) {
+                set_parameter(slot, parameter.name, GL_FLOAT, &value);
             }
-        } else if (std::holds_alternative<glm::vec3>(uniform.value)) {
-            glm::vec3& value = std::get<glm::vec3>(uniform.value);
-            if (ImGui::ColorEdit3(name.c_str(), glm::value_ptr(value))) {
-                set_uniform(name, value);
+        } else if (parameter.type == GL_FLOAT_VEC3) {
+            glm::vec3 value;
+            std::memcpy(glm::value_ptr(value), data, sizeof(value));
+            if (ImGui::ColorEdit3(parameter.name.c_str(), glm::value_ptr(value))) {
+                set_parameter(slot, parameter.name, GL_FLOAT_VEC3, glm::value_ptr(value));
             }
-        } else if (std::holds_alternative<glm::mat4>(uniform.value)) {
+        } else if (parameter.type == GL_FLOAT_MAT4) {
             // TODO: Implement a proper matrix editor.
             ImGui::Text("Matrix4x4 editing not implemented");
         }
+        if (slot != 0 && parameters.is_overridden(slot, parameter) && ImGui::SmallButton("Reset")) {
+            reset_parameter(slot, parameter.name);
+        }
+        ImGui::PopID();
     }
-    
+}
+
+// Displays and allows editing of uniforms via ImGui.
+void Material::draw_uniforms_gui() {
+    draw_parameters_gui(0);
+
     // Iterate over texture uniforms.
     for (auto& [name, texture_uniform] : texture_uniforms) {
         ImGui::Text("Texture Uniform: %s", name.c_str());
@@ -266,4 +511,36 @@ void Material::draw_uniforms_gui() {
             ImGui::Text("No texture assigned");
         }
     }
-}
\ No newline at end of file
+}
+
+//////////////////////
+// MaterialInstance //
+//////////////////////
+
+MaterialInstance::MaterialInstance(std::shared_ptr<Material> parent)
+    : parent(std::move(parent)), slot(this->parent->parameters.allocate_slot()) {}
+
+MaterialInstance::~MaterialInstance() {
+    parent->parameters.release_slot(slot);
+}
+
+bool MaterialInstance::set_uniform(const std::string &name, float value) {
+    return parent->set_parameter(slot, name, GL_FLOAT, &value);
+}
+
+bool MaterialInstance::set_uniform(const std::string &name, glm::vec3 value) {
+    return parent->set_parameter(slot, name, GL_FLOAT_VEC3, glm::value_ptr(value));
+}
+
+bool MaterialInstance::set_uniform(const std::string &name, glm::mat4 value) {
+    return parent->set_parameter(slot, name, GL_FLOAT_MAT4, glm::value_ptr(value));
+}
+
+bool MaterialInstance::reset_uniform(const std::string &name) {
+    return parent->reset_parameter(slot, name);
+}
+
+void MaterialInstance::draw_uniforms_gui() {
+    ImGui::Text("Instance of material %u", parent->get_id());
+    parent->draw_parameters_gui(slot);
+}
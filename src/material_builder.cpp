@@ -0,0 +1,40 @@
+#include "material_builder.hpp"
+#include "asset_manager.hpp"
+#include "engine_config.hpp"
+
+MaterialBuilder &MaterialBuilder::with_preset(MaterialPreset preset) {
+    if (!material) material = std::make_shared<Material>();
+    float smoothness = 5.0;
+
+    switch (preset) {
+        case MaterialPreset::Simple:
+            shader = assets.load_shader("src/shaders/simple");
+            material->set_shader(shader);
+            material->set_uniform("base_color", glm::vec3(1.0, 1.0, 1.0));
+            break;
+        case MaterialPreset::URP:
+            shader = assets.load_shader("src/shaders/urp");
+            material->set_shader(shader);
+            if (config.pack_textures) {
+                material->set_uniform("base_map_array", assets.load_texture_layer("src/objects/dragon/Material_baseColor.png"));
+            } else {
+                material->set_uniform("base_map", assets.load_texture("src/objects/dragon/Material_baseColor.png"));
+            }
+            // material->set_uniform("metallic_map", assets.load_texture("src/objects/dragon/Material_normal.png"));
+            // material->set_uniform("base_color", glm::vec3(1.0, 0, 1.0));
+            // material->set_uniform("normal_map", assets.load_texture("src/objects/dragon/Material_normal.png", {.placeholder = TexturePlaceholder::FlatNormal}));
+            material->set_uniform("smoothness", smoothness);
+            break;
+        // case MaterialPreset::Skybox:
+        //     shader = std::make_shared<Shader>("src/shaders/skybox");
+        //     material->set_shader(shader);
+        //     material->set_depth_test(false);
+        //     material->set_cull_mode(CullMode::Front);
+        //     break;
+        default:
+            std::cerr << "MaterialBuilder: invalid preset\n";
+            break;
+    }
+
+    return *this;
+}
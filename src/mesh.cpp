@@ -1,4 +1,5 @@
 #include "mesh.hpp"
+#include "render_stats.hpp"
 
 Mesh::Mesh() {}
 
@@ -25,69 +26,67 @@ bool Mesh::add_submesh(GLuint index_offset, GLuint index_count) {
     return true;
 }
 
+// Uploaded meshes may have released their vertices, so they answer from the
+// bounds captured at upload time.
 BoundingBox Mesh::get_bounding_box() {
-    BoundingBox bounding_box;
+    if (is_uploaded) return bounding_box;
+
+    BoundingBox bounds;
     for (auto& vertex : vertices) {
-        bounding_box.grow_to_include(vertex.position);
+        bounds.grow_to_include(vertex.position);
     }
 
-    return bounding_box;
+    return bounds;
 }
 
-void Mesh::upload_to_GPU() {
-    if (is_uploaded) return;
-
-    // Generate buffers
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
-    glGenBuffers(1, &ebo);
-
-    // Bind vao
-    glBindVertexArray(vao);
-
-    // Upload vertex data
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
-
-
-    // Set vertex attributes
-    // position
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
-    glEnableVertexAttribArray(0);
-
-    // normal
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-    glEnableVertexAttribArray(1);
-
-    // tangent
-    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, tangent));
-    glEnableVertexAttribArray(2);
-
-    // uv0
-    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, uv0));
-    glEnableVertexAttribArray(3);
+size_t Mesh::get_cpu_bytes() const {
+    return vertices.capacity() * sizeof(Vertex) +
+           indices.capacity() * sizeof(GLuint) +
+           positions.capacity() * sizeof(glm::vec3) +
+           submeshes.capacity() * sizeof(Submesh);
+}
 
-    // uv1
-    glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, uv1));
-    glEnableVertexAttribArray(4);
+// Drops the CPU copies the residency policy does not ask to keep.
+void Mesh::release_cpu_data() {
+    if (residency == MeshResidency::KeepAll) return;
 
+    if (residency == MeshResidency::KeepPositions) {
+        positions.resize(vertices.size());
+        for (size_t i = 0; i < vertices.size(); ++i) {
+            positions[i] = vertices[i].position;
+        }
+    } else {
+        std::vector<GLuint>().swap(indices);
+    }
 
-    // Upload index data
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+    std::vector<Vertex>().swap(vertices);
+}
 
-    // unbind
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+void Mesh::upload_to_GPU() {
+    if (is_uploaded || pending) return;
+
+    // Copy into the shared vertex/index buffers of this vertex format
+    GeometryArena &arena = GeometryArena::get(vertex_format);
+    bool success = arena.allocate(
+        vertices.data(), static_cast<GLuint>(vertices.size()),
+        indices.data(), static_cast<GLuint>(indices.size()),
+        allocation);
+    if (!success) {
+        std::cerr << "Mesh: failed to upload " << name << "\n";
+        return;
+    }
 
+    bounding_box = get_bounding_box();
+    gpu_bytes = vertices.size() * sizeof(Vertex) + indices.size() * sizeof(GLuint);
     is_uploaded = true;
+
+    release_cpu_data();
 }
 
 bool Mesh::bind() const {
     if (!is_uploaded) return false;
 
-    glBindVertexArray(vao);
+    GeometryArena::get(vertex_format).bind();
     return true;
 }
 
@@ -95,122 +94,62 @@ bool Mesh::draw_submesh(size_t submesh_index) const {
     if (!is_uploaded || submesh_index >= submeshes.size()) return false;
 
     const Submesh &submesh = submeshes[submesh_index];
-    glDrawElements(GL_TRIANGLES, submesh.index_count, GL_UNSIGNED_INT, (void*)(submesh.index_offset * sizeof(GLuint)));
+    const GLuint first_index = allocation.first_index + submesh.index_offset;
+    glDrawElementsBaseVertex(GL_TRIANGLES, submesh.index_count, GL_UNSIGNED_INT,
+        (void*)(first_index * sizeof(GLuint)), allocation.base_vertex);
+
+    render_stats.draw_calls++;
+    render_stats.draws++;
+    render_stats.triangles += submesh.index_count / 3;
     return true;
 }
 
-Mesh::~Mesh() {
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &vbo);
-    glDeleteBuffers(1, &ebo);
+bool Mesh::load(const std::string &path) {
+    MeshData data;
+    if (!import_mesh(path, data)) return false;
+    take_data(std::move(data));
+    return true;
 }
 
+bool Mesh::read_cooked(const std::string &path) {
+    MeshData data;
+    if (!read_cooked_mesh(path, data)) return false;
+    take_data(std::move(data));
+    return true;
+}
 
-bool Mesh::load(const std::string& path) {
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(path,
-        aiProcess_Triangulate |
-        aiProcess_GenNormals |
-        aiProcess_CalcTangentSpace |  // Generates tangents/bitangents
-        aiProcess_FlipUVs |
-        aiProcess_JoinIdenticalVertices);
+void Mesh::take_data(MeshData &&data) {
+    name = std::move(data.name);
+    vertex_format = data.vertex_format;
+    vertices = std::move(data.vertices);
+    indices = std::move(data.indices);
+    submeshes = std::move(data.submeshes);
+}
 
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-        std::cerr << "Assimp Error: " << importer.GetErrorString() << std::endl;
-        return false;
+// Takes over CPU-side data produced by a load on another thread.
+// Must run on the main thread; arena space is (re)allocated by the next upload.
+void Mesh::adopt(Mesh &&loaded) {
+    vertices = std::move(loaded.vertices);
+    indices = std::move(loaded.indices);
+    submeshes = std::move(loaded.submeshes);
+    positions.clear();
+    name = std::move(loaded.name);
+
+    if (is_uploaded) {
+        GeometryArena::get(vertex_format).free(allocation);
+        allocation = {};
+        gpu_bytes = 0;
+        is_uploaded = false;
     }
+    pending = false;
+}
 
-    // Clear existing data
-    vertices.clear();
-    indices.clear();
-    submeshes.clear();
-
-    for (unsigned int i = 0; i < scene->mNumMeshes; ++i) {
-        const aiMesh* ai_mesh = scene->mMeshes[i];
-        const size_t vertex_offset = vertices.size();
-        const size_t index_offset = indices.size();
-
-        // Process vertices
-        for (unsigned int j = 0; j < ai_mesh->mNumVertices; ++j) {
-            Vertex vertex;
-
-            // Position
-            vertex.position = {
-                ai_mesh->mVertices[j].x,
-                ai_mesh->mVertices[j].y,
-                ai_mesh->mVertices[j].z
-            };
-
-            // Normal
-            vertex.normal = {
-                ai_mesh->mNormals[j].x,
-                ai_mesh->mNormals[j].y,
-                ai_mesh->mNormals[j].z
-            };
-
-            // Tangent (vec4 with handedness in .w)
-            if (ai_mesh->mTangents) {
-                vertex.tangent = {
-                    ai_mesh->mTangents[j].x,
-                    ai_mesh->mTangents[j].y,
-                    ai_mesh->mTangents[j].z,
-                    1.0f  // Default handedness (adjusted below if bitangents exist)
-                };
-
-                // Calculate correct handedness using bitangent
-                if (ai_mesh->mBitangents) {
-                    const glm::vec3 normal(vertex.normal);
-                    const glm::vec3 tangent(vertex.tangent);
-                    const glm::vec3 bitangent(
-                        ai_mesh->mBitangents[j].x,
-                        ai_mesh->mBitangents[j].y,
-                        ai_mesh->mBitangents[j].z
-                    );
-
-                    const glm::vec3 computed_bitangent = glm::cross(normal, tangent);
-                    vertex.tangent.w = glm::dot(computed_bitangent, bitangent) > 0.0f ? 1.0f : -1.0f;
-                }
-            } else {
-                vertex.tangent = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-            }
-
-            // UV0 (primary texture coordinates)
-            if (ai_mesh->mTextureCoords[0]) {
-                vertex.uv0 = {
-                    ai_mesh->mTextureCoords[0][j].x,
-                    ai_mesh->mTextureCoords[0][j].y
-                };
-            } else {
-                vertex.uv0 = {0.0f, 0.0f};
-            }
-
-            // UV1 (secondary texture coordinates, e.g., lightmaps)
-            if (ai_mesh->mTextureCoords[1]) {
-                vertex.uv1 = {
-                    ai_mesh->mTextureCoords[1][j].x,
-                    ai_mesh->mTextureCoords[1][j].y
-                };
-            } else {
-                vertex.uv1 = {0.0f, 0.0f};
-            }
-
-            vertices.push_back(vertex);
-        }
-
-        // Process indices
-        for (unsigned int j = 0; j < ai_mesh->mNumFaces; ++j) {
-            const aiFace& face = ai_mesh->mFaces[j];
-            for (unsigned int k = 0; k < face.mNumIndices; ++k) {
-                indices.push_back(face.mIndices[k] + vertex_offset);
-            }
-        }
+Mesh::~Mesh() {
+    // Meshes parsed on worker threads never own arena space.
+    if (!is_uploaded) return;
 
-        // Add submesh
-        submeshes.push_back({
-            static_cast<GLuint>(index_offset),
-            static_cast<GLuint>(ai_mesh->mNumFaces * 3)
-        });
+    // The arena may already be gone during engine shutdown.
+    if (GeometryArena *arena = GeometryArena::find(vertex_format)) {
+        arena->free(allocation);
     }
-
-    return true;
-}
\ No newline at end of file
+}
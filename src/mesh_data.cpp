@@ -0,0 +1,271 @@
+#include "mesh_data.hpp"
+#include "thread_pool.hpp"
+#include "asset_pack.hpp"
+#include "profiler.hpp"
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    constexpr uint32_t cooked_mesh_magic = 0x4853454D; // "MESH"
+    constexpr uint32_t cooked_mesh_version = 1;
+
+    // Followed by the name, the vertices, the indices and the submeshes.
+    struct CookedMeshHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vertex_format;
+        uint32_t name_length;
+        uint64_t vertex_count;
+        uint64_t index_count;
+        uint64_t submesh_count;
+    };
+
+    // Converts vertices [begin, end) of an aiMesh into out[begin, end).
+    void convert_vertices(const aiMesh *ai_mesh, unsigned int begin, unsigned int end, StandardVertex *out) {
+        const bool has_tangents = ai_mesh->mTangents != nullptr;
+        const bool has_bitangents = ai_mesh->mBitangents != nullptr;
+        const aiVector3D *uv0 = ai_mesh->mTextureCoords[0];
+        const aiVector3D *uv1 = ai_mesh->mTextureCoords[1];
+
+        for (unsigned int j = begin; j < end; ++j) {
+            StandardVertex &vertex = out[j];
+
+            // Position
+            vertex.position = {
+                ai_mesh->mVertices[j].x,
+                ai_mesh->mVertices[j].y,
+                ai_mesh->mVertices[j].z
+            };
+
+            // Normal
+            vertex.normal = {
+                ai_mesh->mNormals[j].x,
+                ai_mesh->mNormals[j].y,
+                ai_mesh->mNormals[j].z
+            };
+
+            // Tangent (vec4 with handedness in .w)
+            if (has_tangents) {
+                vertex.tangent = {
+                    ai_mesh->mTangents[j].x,
+                    ai_mesh->mTangents[j].y,
+                    ai_mesh->mTangents[j].z,
+                    1.0f  // Default handedness (adjusted below if bitangents exist)
+                };
+
+                // Calculate correct handedness using bitangent
+                if (has_bitangents) {
+                    const glm::vec3 normal(vertex.normal);
+                    const glm::vec3 tangent(vertex.tangent);
+                    const glm::vec3 bitangent(
+                        ai_mesh->mBitangents[j].x,
+                        ai_mesh->mBitangents[j].y,
+                        ai_mesh->mBitangents[j].z
+                    );
+
+                    const glm::vec3 computed_bitangent = glm::cross(normal, tangent);
+                    vertex.tangent.w = glm::dot(computed_bitangent, bitangent) > 0.0f ? 1.0f : -1.0f;
+                }
+            } else {
+                vertex.tangent = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+            }
+
+            // UV0 (primary texture coordinates)
+            vertex.uv0 = uv0 ? glm::vec2(uv0[j].x, uv0[j].y) : glm::vec2(0.0f);
+
+            // UV1 (secondary texture coordinates, e.g., lightmaps)
+            vertex.uv1 = uv1 ? glm::vec2(uv1[j].x, uv1[j].y) : glm::vec2(0.0f);
+        }
+    }
+}
+
+bool import_mesh(const std::string &path, MeshData &mesh) {
+    PROFILE_SCOPE("import_mesh");
+    const unsigned int flags =
+        aiProcess_Triangulate |
+        aiProcess_GenNormals |
+        aiProcess_CalcTangentSpace |  // Generates tangents/bitangents
+        aiProcess_FlipUVs |
+        aiProcess_JoinIdenticalVertices;
+
+    // Packed files are parsed in place; the extension tells Assimp the format.
+    Assimp::Importer importer;
+    AssetBytes packed;
+    const aiScene* scene = nullptr;
+    if (AssetPack::read_mounted(path, packed)) {
+        const std::string extension = std::filesystem::path(path).extension().string();
+        scene = importer.ReadFileFromMemory(packed.data, packed.size, flags, extension.empty() ? "" : extension.c_str() + 1);
+    } else {
+        scene = importer.ReadFile(path, flags);
+    }
+
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        std::cerr << "Assimp Error: " << importer.GetErrorString() << std::endl;
+        return false;
+    }
+
+    // Lay out every aiMesh up front so each range can be converted independently.
+    struct MeshRange {
+        size_t vertex_offset;
+        size_t index_offset;
+        size_t index_count;
+    };
+
+    std::vector<MeshRange> ranges(scene->mNumMeshes);
+    size_t vertex_count = 0;
+    size_t index_count = 0;
+    for (unsigned int i = 0; i < scene->mNumMeshes; ++i) {
+        const aiMesh* ai_mesh = scene->mMeshes[i];
+
+        size_t mesh_index_count = 0;
+        for (unsigned int j = 0; j < ai_mesh->mNumFaces; ++j) {
+            mesh_index_count += ai_mesh->mFaces[j].mNumIndices;
+        }
+
+        ranges[i] = {vertex_count, index_count, mesh_index_count};
+        vertex_count += ai_mesh->mNumVertices;
+        index_count += mesh_index_count;
+    }
+
+    mesh.name = path;
+    mesh.vertex_format = VertexFormat::Standard;
+    mesh.vertices.assign(vertex_count, StandardVertex());
+    mesh.indices.assign(index_count, 0);
+    mesh.submeshes.clear();
+
+    // One task per vertex block of every aiMesh, plus one index task per aiMesh.
+    struct ConversionTask {
+        unsigned int mesh;
+        unsigned int begin;
+        unsigned int end;
+        bool is_index_task;
+    };
+
+    constexpr unsigned int vertex_block_size = 16384;
+    std::vector<ConversionTask> tasks;
+    for (unsigned int i = 0; i < scene->mNumMeshes; ++i) {
+        const unsigned int mesh_vertex_count = scene->mMeshes[i]->mNumVertices;
+        for (unsigned int begin = 0; begin < mesh_vertex_count; begin += vertex_block_size) {
+            tasks.push_back({i, begin, std::min(begin + vertex_block_size, mesh_vertex_count), false});
+        }
+        tasks.push_back({i, 0, 0, true});
+    }
+
+    parallel_for(tasks.size(), [&](size_t first, size_t last) {
+        for (size_t t = first; t < last; ++t) {
+            const ConversionTask &task = tasks[t];
+            const aiMesh* ai_mesh = scene->mMeshes[task.mesh];
+            const MeshRange &range = ranges[task.mesh];
+
+            if (!task.is_index_task) {
+                convert_vertices(ai_mesh, task.begin, task.end, mesh.vertices.data() + range.vertex_offset);
+                continue;
+            }
+
+            uint32_t *out = mesh.indices.data() + range.index_offset;
+            const uint32_t vertex_offset = static_cast<uint32_t>(range.vertex_offset);
+            for (unsigned int j = 0; j < ai_mesh->mNumFaces; ++j) {
+                const aiFace& face = ai_mesh->mFaces[j];
+                for (unsigned int k = 0; k < face.mNumIndices; ++k) {
+                    *out++ = face.mIndices[k] + vertex_offset;
+                }
+            }
+        }
+    });
+
+    // Add submeshes
+    for (const MeshRange &range : ranges) {
+        mesh.submeshes.push_back({
+            static_cast<uint32_t>(range.index_offset),
+            static_cast<uint32_t>(range.index_count)
+        });
+    }
+
+    return true;
+}
+
+bool write_cooked_mesh(const std::string &path, const MeshData &mesh) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Mesh: failed to create " << path << "\n";
+        return false;
+    }
+
+    const CookedMeshHeader header{
+        cooked_mesh_magic,
+        cooked_mesh_version,
+        static_cast<uint32_t>(mesh.vertex_format),
+        static_cast<uint32_t>(mesh.name.size()),
+        mesh.vertices.size(),
+        mesh.indices.size(),
+        mesh.submeshes.size()
+    };
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(mesh.name.data(), static_cast<std::streamsize>(mesh.name.size()));
+    file.write(reinterpret_cast<const char *>(mesh.vertices.data()), static_cast<std::streamsize>(mesh.vertices.size() * sizeof(StandardVertex)));
+    file.write(reinterpret_cast<const char *>(mesh.indices.data()), static_cast<std::streamsize>(mesh.indices.size() * sizeof(uint32_t)));
+    file.write(reinterpret_cast<const char *>(mesh.submeshes.data()), static_cast<std::streamsize>(mesh.submeshes.size() * sizeof(MeshData::Submesh)));
+    return bool(file);
+}
+
+bool read_cooked_mesh(const std::string &path, MeshData &mesh) {
+    AssetBytes bytes;
+    if (!AssetPack::read_mounted(path, bytes)) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) return false;
+        bytes.storage.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char *>(bytes.storage.data()), static_cast<std::streamsize>(bytes.storage.size()));
+        if (!file) return false;
+        bytes.data = bytes.storage.data();
+        bytes.size = bytes.storage.size();
+    }
+
+    size_t position = 0;
+    auto read = [&](void *destination, size_t size) {
+        if (position > bytes.size || bytes.size - position < size) return false;
+        std::memcpy(destination, bytes.data + position, size);
+        position += size;
+        return true;
+    };
+
+    CookedMeshHeader header;
+    if (!read(&header, sizeof(header)) || header.magic != cooked_mesh_magic || header.version != cooked_mesh_version ||
+        header.vertex_format != static_cast<uint32_t>(VertexFormat::Standard)) {
+        std::cerr << "Mesh: " << path << " is not a version " << cooked_mesh_version << " cooked mesh\n";
+        return false;
+    }
+
+    // Checked before resizing so a damaged header cannot ask for huge allocations.
+    const size_t remaining = bytes.size - position;
+    if (header.name_length > remaining ||
+        header.vertex_count > remaining / sizeof(StandardVertex) ||
+        header.index_count > remaining / sizeof(uint32_t) ||
+        header.submesh_count > remaining / sizeof(MeshData::Submesh)) {
+        std::cerr << "Mesh: " << path << " is truncated\n";
+        return false;
+    }
+
+    mesh.name.resize(header.name_length);
+    mesh.vertices.resize(header.vertex_count);
+    mesh.indices.resize(header.index_count);
+    mesh.submeshes.resize(header.submesh_count);
+    if (!read(mesh.name.data(), mesh.name.size()) ||
+        !read(mesh.vertices.data(), mesh.vertices.size() * sizeof(StandardVertex)) ||
+        !read(mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t)) ||
+        !read(mesh.submeshes.data(), mesh.submeshes.size() * sizeof(MeshData::Submesh))) {
+        std::cerr << "Mesh: " << path << " is truncated\n";
+        return false;
+    }
+    mesh.vertex_format = VertexFormat::Standard;
+    return true;
+}
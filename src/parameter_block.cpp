@@ -0,0 +1,136 @@
+#include "parameter_block.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+const ParameterLayout::Parameter *ParameterLayout::find(const std::string &name) const {
+    for (const Parameter &parameter : parameters) {
+        if (parameter.name == name) return &parameter;
+    }
+    return nullptr;
+}
+
+size_t get_parameter_size(GLenum type) {
+    switch (type) {
+        case GL_FLOAT: case GL_INT: case GL_BOOL: return 4;
+        case GL_FLOAT_VEC2: return 8;
+        case GL_FLOAT_VEC3: return 12;
+        case GL_FLOAT_VEC4: return 16;
+        case GL_FLOAT_MAT3: return 48;
+        case GL_FLOAT_MAT4: return 64;
+        default: return 0;
+    }
+}
+
+namespace {
+    size_t align_up(size_t value, size_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+void ParameterBlock::mark_dirty(size_t begin, size_t end) {
+    if (dirty_begin == dirty_end) {
+        dirty_begin = begin;
+        dirty_end = end;
+        return;
+    }
+    dirty_begin = std::min(dirty_begin, begin);
+    dirty_end = std::max(dirty_end, end);
+}
+
+void ParameterBlock::set_layout(std::shared_ptr<const ParameterLayout> new_layout, size_t window_alignment) {
+    const std::shared_ptr<const ParameterLayout> old_layout = std::move(layout);
+    const std::vector<unsigned char> old_data = std::move(data);
+    const size_t old_window_stride = window_stride;
+    auto get_old_slot_offset = [&](size_t slot) {
+        return slot / old_layout->slot_count * old_window_stride + slot % old_layout->slot_count * old_layout->size;
+    };
+
+    layout = std::move(new_layout);
+    window_stride = align_up(get_window_size(), std::max<size_t>(1, window_alignment));
+    // Whole windows, since a binding must cover the block the shader declares.
+    const size_t window_count = (overrides.size() + layout->slot_count - 1) / layout->slot_count;
+    data.assign(window_count * window_stride, 0);
+
+    std::vector<uint64_t> new_overrides(overrides.size(), 0);
+    for (size_t index = 0; index < layout->parameters.size(); ++index) {
+        const ParameterLayout::Parameter &parameter = layout->parameters[index];
+        const ParameterLayout::Parameter *old = old_layout->find(parameter.name);
+        if (!old || old->type != parameter.type) continue;
+
+        const size_t old_index = old - old_layout->parameters.data();
+        for (uint32_t slot = 0; slot < overrides.size(); ++slot) {
+            std::memcpy(data.data() + get_slot_offset(slot) + parameter.offset,
+                        old_data.data() + get_old_slot_offset(slot) + old->offset, get_parameter_size(parameter.type));
+            if (index < max_overrides && old_index < max_overrides && (overrides[slot] >> old_index & 1)) {
+                new_overrides[slot] |= uint64_t(1) << index;
+            }
+        }
+    }
+    overrides = std::move(new_overrides);
+    mark_dirty(0, data.size());
+}
+
+uint32_t ParameterBlock::allocate_slot() {
+    uint32_t slot;
+    if (!free_slots.empty()) {
+        slot = free_slots.back();
+        free_slots.pop_back();
+    } else {
+        slot = static_cast<uint32_t>(overrides.size());
+        overrides.push_back(0);
+        if (get_window_index(slot) == 0) data.resize(data.size() + window_stride, 0);
+    }
+
+    overrides[slot] = 0;
+    const size_t offset = get_slot_offset(slot);
+    if (layout->size) {
+        std::memcpy(data.data() + offset, data.data(), layout->size);
+        mark_dirty(offset, offset + layout->size);
+    }
+    return slot;
+}
+
+void ParameterBlock::release_slot(uint32_t slot) {
+    overrides[slot] = 0;
+    free_slots.push_back(slot);
+}
+
+void ParameterBlock::set(uint32_t slot, const ParameterLayout::Parameter &parameter, const void *value) {
+    const size_t index = &parameter - layout->parameters.data();
+    const size_t size = get_parameter_size(parameter.type);
+    auto write = [&](uint32_t target) {
+        const size_t offset = get_slot_offset(target) + parameter.offset;
+        if (std::memcmp(data.data() + offset, value, size) == 0) return;
+        std::memcpy(data.data() + offset, value, size);
+        mark_dirty(offset, offset + size);
+    };
+
+    write(slot);
+    if (slot != 0) {
+        if (index < max_overrides) overrides[slot] |= uint64_t(1) << index;
+        return;
+    }
+    for (uint32_t target = 1; target < overrides.size(); ++target) {
+        if (!is_overridden(target, parameter)) write(target);
+    }
+}
+
+void ParameterBlock::reset(uint32_t slot, const ParameterLayout::Parameter &parameter) {
+    const size_t index = &parameter - layout->parameters.data();
+    if (index < max_overrides) overrides[slot] &= ~(uint64_t(1) << index);
+
+    const size_t offset = get_slot_offset(slot) + parameter.offset;
+    const size_t size = get_parameter_size(parameter.type);
+    std::memcpy(data.data() + offset, get(0, parameter), size);
+    mark_dirty(offset, offset + size);
+}
+
+bool ParameterBlock::is_overridden(uint32_t slot, const ParameterLayout::Parameter &parameter) const {
+    const size_t index = &parameter - layout->parameters.data();
+    return index < max_overrides && (overrides[slot] >> index & 1);
+}
+
+const unsigned char *ParameterBlock::get(uint32_t slot, const ParameterLayout::Parameter &parameter) const {
+    return data.data() + get_slot_offset(slot) + parameter.offset;
+}
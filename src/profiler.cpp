@@ -0,0 +1,207 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+namespace {
+    // A ring entry, its fields atomic so that capture() may read an entry
+    // while the owner overwrites it; such a read is detected and dropped.
+    struct StoredZone {
+        std::atomic<const char *> name{nullptr};
+        std::atomic<uint64_t> start_ns{0};
+        std::atomic<uint64_t> end_ns{0};
+        std::atomic<uint32_t> depth{0};
+
+        void store(const ProfileZone &zone) {
+            name.store(zone.name, std::memory_order_relaxed);
+            start_ns.store(zone.start_ns, std::memory_order_relaxed);
+            end_ns.store(zone.end_ns, std::memory_order_relaxed);
+            depth.store(zone.depth, std::memory_order_relaxed);
+        }
+
+        ProfileZone load() const {
+            return {name.load(std::memory_order_relaxed), start_ns.load(std::memory_order_relaxed),
+                    end_ns.load(std::memory_order_relaxed), depth.load(std::memory_order_relaxed)};
+        }
+    };
+
+    struct ThreadBuffer {
+        uint32_t id;
+        std::string name;       // guarded by buffers_mutex
+        bool in_use = false;    // guarded by buffers_mutex
+        uint32_t depth = 0;     // owning thread only
+        std::unique_ptr<StoredZone[]> zones = std::make_unique<StoredZone[]>(Profiler::zones_per_thread);
+        std::atomic<uint64_t> write_index{0}; // zones ever written; the owner is the only writer
+    };
+
+    std::mutex buffers_mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::atomic<bool> enabled{true};
+    std::atomic<uint64_t> frame_start{0};
+    std::atomic<uint64_t> previous_frame_start{0};
+
+    // Hands the thread's buffer back for reuse when the thread exits.
+    struct ThreadBufferOwner {
+        ThreadBuffer *buffer = nullptr;
+
+        ~ThreadBufferOwner() {
+            if (!buffer) return;
+            std::lock_guard<std::mutex> lock(buffers_mutex);
+            buffer->in_use = false;
+        }
+    };
+    thread_local ThreadBufferOwner owner;
+
+    ThreadBuffer &get_thread_buffer() {
+        if (owner.buffer) return *owner.buffer;
+
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        for (auto &buffer : buffers) {
+            if (!buffer->in_use) {
+                owner.buffer = buffer.get();
+                break;
+            }
+        }
+        if (!owner.buffer) {
+            auto buffer = std::make_unique<ThreadBuffer>();
+            buffer->id = static_cast<uint32_t>(buffers.size());
+            buffer->name = "thread " + std::to_string(buffer->id);
+            owner.buffer = buffer.get();
+            buffers.push_back(std::move(buffer));
+        }
+        owner.buffer->in_use = true;
+        owner.buffer->depth = 0;
+        return *owner.buffer;
+    }
+
+    // Seqlock-style copy: reads the ring without stopping the owner, then
+    // drops every entry the owner may have been rewriting meanwhile. With
+    // the write index at n after the copy, slot n % capacity can be half
+    // written, so entries below n - capacity + 1 are not trusted.
+    std::vector<ProfileZone> read_zones(const ThreadBuffer &buffer, uint64_t from_ns, uint64_t to_ns) {
+        const uint64_t capacity = Profiler::zones_per_thread;
+        const uint64_t end = buffer.write_index.load(std::memory_order_acquire);
+        const uint64_t begin = end > capacity ? end - capacity : 0;
+
+        std::vector<ProfileZone> zones;
+        zones.reserve(static_cast<size_t>(end - begin));
+        for (uint64_t i = begin; i < end; ++i) zones.push_back(buffer.zones[i % capacity].load());
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t after = buffer.write_index.load(std::memory_order_relaxed);
+        const uint64_t first_valid = after >= capacity ? after - capacity + 1 : 0;
+        if (first_valid > begin) {
+            zones.erase(zones.begin(), zones.begin() + static_cast<ptrdiff_t>(std::min(first_valid - begin, end - begin)));
+        }
+
+        std::erase_if(zones, [&](const ProfileZone &zone) { return zone.end_ns <= from_ns || zone.start_ns >= to_ns; });
+        return zones;
+    }
+
+    void write_json_string(std::ostream &out, const std::string &text) {
+        out << '"';
+        for (char c : text) {
+            if (c == '"' || c == '\\') out << '\\';
+            out << c;
+        }
+        out << '"';
+    }
+}
+
+uint64_t Profiler::now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Profiler::set_enabled(bool value) {
+    enabled.store(value, std::memory_order_relaxed);
+}
+
+bool Profiler::is_enabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void Profiler::set_thread_name(const char *name) {
+    ThreadBuffer &buffer = get_thread_buffer();
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    buffer.name = name;
+}
+
+uint32_t Profiler::push_zone() {
+    return get_thread_buffer().depth++;
+}
+
+void Profiler::pop_zone(const char *name, uint64_t start_ns, uint32_t depth) {
+    ThreadBuffer &buffer = get_thread_buffer();
+    const uint64_t index = buffer.write_index.load(std::memory_order_relaxed);
+    // Pairs with the fence in read_zones: a reader that sees any of these
+    // stores also sees write_index at index.
+    std::atomic_thread_fence(std::memory_order_release);
+    buffer.zones[index % zones_per_thread].store({name, start_ns, now_ns(), depth});
+    buffer.write_index.store(index + 1, std::memory_order_release);
+    buffer.depth = depth;
+}
+
+void Profiler::mark_frame() {
+    previous_frame_start.store(frame_start.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    frame_start.store(now_ns(), std::memory_order_relaxed);
+}
+
+bool Profiler::get_last_frame(uint64_t &start_ns, uint64_t &end_ns) {
+    start_ns = previous_frame_start.load(std::memory_order_relaxed);
+    end_ns = frame_start.load(std::memory_order_relaxed);
+    return start_ns != 0 && end_ns > start_ns;
+}
+
+std::vector<ProfileThread> Profiler::capture(uint64_t from_ns, uint64_t to_ns) {
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+
+    std::vector<ProfileThread> threads;
+    for (const auto &buffer : buffers) {
+        std::vector<ProfileZone> zones = read_zones(*buffer, from_ns, to_ns);
+        if (zones.empty()) continue;
+        threads.push_back({buffer->id, buffer->name, std::move(zones)});
+    }
+    return threads;
+}
+
+bool Profiler::write_chrome_trace(const std::string &path) {
+    const std::vector<ProfileThread> threads = capture();
+
+    uint64_t origin_ns = UINT64_MAX;
+    for (const ProfileThread &thread : threads) {
+        for (const ProfileZone &zone : thread.zones) origin_ns = std::min(origin_ns, zone.start_ns);
+    }
+
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        std::cerr << "Profiler: failed to write " << path << "\n";
+        return false;
+    }
+
+    // Complete ("X") events in microseconds, plus a name record per thread.
+    file << std::fixed << std::setprecision(3) << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (const ProfileThread &thread : threads) {
+        file << (first ? "" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << thread.id << ",\"args\":{\"name\":";
+        write_json_string(file, thread.name);
+        file << "}}";
+        first = false;
+
+        for (const ProfileZone &zone : thread.zones) {
+            file << ",\n{\"ph\":\"X\",\"name\":";
+            write_json_string(file, zone.name);
+            file << ",\"pid\":1,\"tid\":" << thread.id
+                 << ",\"ts\":" << (zone.start_ns - origin_ns) / 1000.0
+                 << ",\"dur\":" << (zone.end_ns - zone.start_ns) / 1000.0 << "}";
+        }
+    }
+    file << "\n]}\n";
+    return bool(file);
+}
@@ -0,0 +1,341 @@
+#include "render_queue.hpp"
+#include "engine_config.hpp"
+#include "gpu_profiler.hpp"
+#include "render_stats.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+// Opaque:      [63] 0 | [62..48] program | [47..24] material batch key | [23..0] mesh
+// Transparent: [63] 1 | [62..32] view depth, far to near | [31..0] material batch key
+// Blended items must draw back to front, so depth outranks state for them.
+uint64_t RenderQueue::make_sort_key(const DrawItem &item, const glm::mat4 &view) {
+    const Material &material = *item.material;
+    const uint64_t batch = material.get_batch_key() ^ (material.get_batch_key() >> 24) ^ (material.get_batch_key() >> 48);
+    if (material.get_blend_mode() != BlendMode::Opaque) {
+        // Non-negative floats order like their bit patterns.
+        const float depth = std::max(0.0f, -(view * item.transform[3]).z);
+        uint32_t depth_bits;
+        std::memcpy(&depth_bits, &depth, sizeof(depth_bits));
+
+        return (uint64_t(1) << 63) |
+               (static_cast<uint64_t>(0x7FFFFFFF - depth_bits) << 32) |
+               (batch & 0xFFFFFFFF);
+    }
+
+    const uint64_t program = material.get_program(); // differs per shader variant
+    return ((program & 0x7FFF) << 48) |
+           ((batch & 0xFFFFFF) << 24) |
+           (static_cast<uint64_t>(item.mesh->get_id()) & 0xFFFFFF);
+}
+
+// Uploads the frame block, then refreshes the batch key and uploads the
+// changed parameters of every material drawn this frame.
+void RenderQueue::prepare_materials(const FrameParams &frame) {
+    const FrameUniforms frame_uniforms{
+        frame.projection,
+        frame.view,
+        glm::vec4(frame.camera_position, 1.0f),
+        glm::vec4(frame.light_properties.direction, 0.0f),
+        glm::vec4(frame.light_properties.ambient, 0.0f),
+        glm::vec4(frame.light_properties.diffuse, 0.0f),
+        glm::vec4(frame.light_properties.specular, 0.0f)
+    };
+    glBindBuffer(GL_UNIFORM_BUFFER, frame_buffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(frame_uniforms), &frame_uniforms, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, Shader::frame_block_binding, frame_buffer);
+    render_stats.uniform_uploads++;
+    render_stats.uniform_upload_bytes += sizeof(frame_uniforms);
+    render_stats.uniform_buffer_binds++;
+
+    frame_materials.clear();
+    for (const DrawItem &item : items) frame_materials.push_back(item.material);
+    std::sort(frame_materials.begin(), frame_materials.end());
+    frame_materials.erase(std::unique(frame_materials.begin(), frame_materials.end()), frame_materials.end());
+
+    for (Material *material : frame_materials) {
+        material->update_batch_key();
+        material->upload_parameters();
+    }
+}
+
+// Approximate height in pixels of the item's bounding sphere on screen.
+float RenderQueue::get_screen_size(const DrawItem &item, const FrameParams &frame) {
+    const BoundingBox &bounds = item.mesh->get_uploaded_bounds();
+    const glm::vec3 center = glm::vec3(item.transform * glm::vec4(bounds.get_center(), 1.0f));
+    const float scale = std::max({glm::length(glm::vec3(item.transform[0])),
+                                  glm::length(glm::vec3(item.transform[1])),
+                                  glm::length(glm::vec3(item.transform[2]))});
+    const float radius = bounds.get_radius() * scale;
+    const float distance = glm::length(center - frame.camera_position);
+
+    const float screen_height = static_cast<float>(config.screen_height);
+    if (distance <= radius) return screen_height;
+    return std::min(screen_height, radius * frame.projection[1][1] * screen_height / distance);
+}
+
+void RenderQueue::submit(const Mesh &mesh, size_t submesh_index, Material &material, const glm::mat4 &transform, const glm::mat3 &normal_matrix,
+                         uint32_t parameter_slot, const MaterialPropertyBlock &properties) {
+    items.push_back({
+        0, // set in flush, once material batch keys are current
+        &mesh,
+        static_cast<GLuint>(submesh_index),
+        &material,
+        parameter_slot,
+        transform,
+        normal_matrix,
+        properties
+    });
+}
+
+void RenderQueue::create_buffers() {
+    if (!frame_buffer) glGenBuffers(1, &frame_buffer);
+    if (!draw_data_buffer) glGenBuffers(1, &draw_data_buffer);
+    if (!indirect_buffer && gl_extensions.multi_draw_indirect) glGenBuffers(1, &indirect_buffer);
+}
+
+void RenderQueue::shutdown() {
+    if (frame_buffer) glDeleteBuffers(1, &frame_buffer);
+    if (draw_data_buffer) glDeleteBuffers(1, &draw_data_buffer);
+    if (indirect_buffer) glDeleteBuffers(1, &indirect_buffer);
+    frame_buffer = 0;
+    draw_data_buffer = 0;
+    indirect_buffer = 0;
+}
+
+// Points the per-draw attributes of the bound VAO at draw_data[first_draw].
+void RenderQueue::bind_draw_data(size_t first_draw) const {
+    glBindBuffer(GL_ARRAY_BUFFER, draw_data_buffer);
+    const size_t base = first_draw * sizeof(DrawData);
+    for (GLuint column = 0; column < 4; ++column) {
+        const GLuint location = draw_data_location + column;
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(DrawData),
+            (void*)(base + offsetof(DrawData, transform) + column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(location, 1);
+        glEnableVertexAttribArray(location);
+    }
+
+    const GLuint rect_location = draw_data_location + 4;
+    glVertexAttribPointer(rect_location, 4, GL_FLOAT, GL_FALSE, sizeof(DrawData), (void*)(base + offsetof(DrawData, texture_rect)));
+    glVertexAttribDivisor(rect_location, 1);
+    glEnableVertexAttribArray(rect_location);
+
+    // texture_layer and parameter_slot, as one vec2
+    const GLuint indices_location = draw_data_location + 5;
+    glVertexAttribPointer(indices_location, 2, GL_FLOAT, GL_FALSE, sizeof(DrawData), (void*)(base + offsetof(DrawData, texture_layer)));
+    glVertexAttribDivisor(indices_location, 1);
+    glEnableVertexAttribArray(indices_location);
+
+    for (GLuint column = 0; column < 3; ++column) {
+        const GLuint location = draw_data_location + 6 + column;
+        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(DrawData),
+            (void*)(base + offsetof(DrawData, normal_matrix) + column * sizeof(glm::vec3)));
+        glVertexAttribDivisor(location, 1);
+        glEnableVertexAttribArray(location);
+    }
+
+    const GLuint tint_location = draw_data_location + 9;
+    glVertexAttribPointer(tint_location, 4, GL_FLOAT, GL_FALSE, sizeof(DrawData), (void*)(base + offsetof(DrawData, tint)));
+    glVertexAttribDivisor(tint_location, 1);
+    glEnableVertexAttribArray(tint_location);
+
+    const GLuint custom_location = draw_data_location + 10;
+    glVertexAttribPointer(custom_location, 4, GL_FLOAT, GL_FALSE, sizeof(DrawData), (void*)(base + offsetof(DrawData, custom)));
+    glVertexAttribDivisor(custom_location, 1);
+    glEnableVertexAttribArray(custom_location);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// One glMultiDrawElementsIndirect for the whole run; base_instance selects each draw's data.
+void RenderQueue::draw_run_indirect(size_t begin, size_t end) {
+    const size_t first_command = commands.size();
+    for (size_t i = begin; i < end; ++i) {
+        const DrawItem &item = items[i];
+        const GeometryAllocation &allocation = item.mesh->get_allocation();
+        const Mesh::Submesh &submesh = item.mesh->get_submesh(item.submesh_index);
+        render_stats.triangles += submesh.index_count / 3;
+
+        commands.push_back({
+            submesh.index_count,
+            1,
+            allocation.first_index + submesh.index_offset,
+            allocation.base_vertex,
+            static_cast<GLuint>(i)
+        });
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER,
+        first_command * sizeof(DrawElementsIndirectCommand),
+        (end - begin) * sizeof(DrawElementsIndirectCommand),
+        commands.data() + first_command);
+    gl_extensions.multi_draw_elements_indirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+        (void*)(first_command * sizeof(DrawElementsIndirectCommand)),
+        static_cast<GLsizei>(end - begin), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    render_stats.draw_calls++;
+    render_stats.draws += end - begin;
+    render_stats.buffer_upload_bytes += (end - begin) * sizeof(DrawElementsIndirectCommand);
+}
+
+// GL 3.3 has no way to index per-draw data inside a multi-draw, so collapse
+// consecutive draws of the same submesh into one instanced draw instead.
+void RenderQueue::draw_run_instanced(size_t begin, size_t end) {
+    size_t group_begin = begin;
+    while (group_begin < end) {
+        const DrawItem &first = items[group_begin];
+        size_t group_end = group_begin + 1;
+        while (group_end < end &&
+               items[group_end].mesh == first.mesh &&
+               items[group_end].submesh_index == first.submesh_index) {
+            ++group_end;
+        }
+
+        const GeometryAllocation &allocation = first.mesh->get_allocation();
+        const Mesh::Submesh &submesh = first.mesh->get_submesh(first.submesh_index);
+        const GLuint first_index = allocation.first_index + submesh.index_offset;
+
+        bind_draw_data(group_begin);
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, submesh.index_count, GL_UNSIGNED_INT,
+            (void*)(first_index * sizeof(GLuint)),
+            static_cast<GLsizei>(group_end - group_begin), allocation.base_vertex);
+
+        render_stats.draw_calls++;
+        render_stats.draws += group_end - group_begin;
+        render_stats.triangles += static_cast<uint64_t>(submesh.index_count / 3) * (group_end - group_begin);
+        group_begin = group_end;
+    }
+}
+
+void RenderQueue::flush(const FrameParams &frame) {
+    if (items.empty()) return;
+    create_buffers();
+
+    prepare_materials(frame);
+    for (DrawItem &item : items) item.sort_key = make_sort_key(item, frame.view);
+
+    // Stable, so items with equal keys keep submission order from frame to
+    // frame. Within an opaque batch, instances order by parent and window
+    // ahead of the mesh, so each window draws in one group.
+    std::stable_sort(items.begin(), items.end(), [](const DrawItem &a, const DrawItem &b) {
+        const bool transparent = (a.sort_key | b.sort_key) >> 63;
+        if (transparent || (a.sort_key >> 24) != (b.sort_key >> 24)) return a.sort_key < b.sort_key;
+
+        const Material *a_source = a.parameter_slot ? a.material : nullptr;
+        const Material *b_source = b.parameter_slot ? b.material : nullptr;
+        if (a_source != b_source) return a_source < b_source;
+        const uint32_t a_window = a.material->get_parameter_window(a.parameter_slot);
+        const uint32_t b_window = b.material->get_parameter_window(b.parameter_slot);
+        if (a_window != b_window) return a_window < b_window;
+        if (a.sort_key != b.sort_key) return a.sort_key < b.sort_key;
+        return a.submesh_index < b.submesh_index;
+    });
+
+    // Per-draw data in sorted order, so draw i reads draw_data[i]
+    draw_data.resize(items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        draw_data[i].transform = items[i].transform;
+        draw_data[i].normal_matrix = items[i].normal_matrix;
+        draw_data[i].tint = items[i].properties.tint;
+        draw_data[i].custom = items[i].properties.custom;
+
+        const TextureLayer *layer = items[i].material->get_texture_layer();
+        const bool has_layer = layer && layer->is_ready();
+        draw_data[i].texture_rect = has_layer ? layer->rect : glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+        draw_data[i].texture_layer = has_layer ? static_cast<float>(layer->layer) : -1.0f;
+        draw_data[i].parameter_slot = static_cast<float>(items[i].material->get_parameter_window_index(items[i].parameter_slot));
+    }
+
+    // Assumes a texture spans the object once, which is what TextureStreamer sizes mips for.
+    if (config.texture_streaming) {
+        for (const DrawItem &item : items) {
+            item.material->request_texture_resolution(get_screen_size(item, frame));
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, draw_data_buffer);
+    glBufferData(GL_ARRAY_BUFFER, draw_data.size() * sizeof(DrawData), draw_data.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    render_stats.buffer_upload_bytes += draw_data.size() * sizeof(DrawData);
+
+    const bool use_indirect = gl_extensions.multi_draw_indirect && config.multi_draw_indirect;
+    if (use_indirect) {
+        commands.clear();
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, items.size() * sizeof(DrawElementsIndirectCommand), nullptr, GL_STREAM_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+    // A run shares a material batch key (and so program, render state and
+    // bindings) and vertex format; the first material applies for all of it.
+    int sampler_unit_count = 0;
+    size_t run_begin = 0;
+    bool transparent_pass = false;
+    GpuProfiler::begin_pass("Opaque");
+    while (run_begin < items.size()) {
+        Material *material = items[run_begin].material;
+        if (!transparent_pass && (items[run_begin].sort_key >> 63)) {
+            GpuProfiler::begin_pass("Transparent");
+            transparent_pass = true;
+        }
+        const VertexFormat format = items[run_begin].mesh->get_vertex_format();
+
+        size_t run_end = run_begin + 1;
+        while (run_end < items.size() &&
+               items[run_end].material->get_batch_key() == material->get_batch_key() &&
+               items[run_end].mesh->get_vertex_format() == format) {
+            ++run_end;
+        }
+
+        material->apply();
+        sampler_unit_count = std::max(sampler_unit_count, material->get_texture_unit_count());
+
+        GeometryArena::get(format).bind();
+        if (use_indirect) bind_draw_data(0);
+
+        // Groups read one window of one parameter buffer. A material's own
+        // values (slot 0) are part of its batch key, so slot 0 draws of any
+        // material in the run read the same values from any window 0.
+        const Material *bound_source = material;
+        uint32_t bound_window = 0;
+        size_t group_begin = run_begin;
+        while (group_begin < run_end) {
+            const Material *source = nullptr;
+            uint32_t window = 0;
+            size_t group_end = group_begin;
+            for (; group_end < run_end; ++group_end) {
+                const DrawItem &item = items[group_end];
+                const uint32_t item_window = item.material->get_parameter_window(item.parameter_slot);
+                if (group_end != group_begin && item_window != window) break;
+                if (item.parameter_slot != 0) {
+                    if (source && source != item.material) break;
+                    source = item.material;
+                }
+                window = item_window;
+            }
+
+            if (!source) source = bound_window == 0 ? bound_source : material;
+            if (source != bound_source || window != bound_window) {
+                source->bind_parameters(window);
+                bound_source = source;
+                bound_window = window;
+            }
+            if (use_indirect) {
+                draw_run_indirect(group_begin, group_end);
+            } else {
+                draw_run_instanced(group_begin, group_end);
+            }
+            group_begin = group_end;
+        }
+
+        run_begin = run_end;
+    }
+    GpuProfiler::end_pass();
+
+    glBindVertexArray(0);
+
+    // Leave the units as the skybox and UI expect them, sampling with texture state.
+    for (int unit = 0; unit < sampler_unit_count; ++unit) glBindSampler(unit, 0);
+}
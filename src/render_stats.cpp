@@ -0,0 +1,47 @@
+#include "render_stats.hpp"
+
+#include <algorithm>
+
+RenderStats render_stats;
+RenderStatsHistory render_stats_history;
+
+const std::array<RenderStats::Field, 11> RenderStats::fields = {{
+    {"Draw calls", &RenderStats::draw_calls},
+    {"Draws", &RenderStats::draws},
+    {"Triangles", &RenderStats::triangles},
+    {"Material applies", &RenderStats::material_applies},
+    {"Vertex array binds", &RenderStats::vertex_array_binds},
+    {"Texture binds", &RenderStats::texture_binds},
+    {"Uniform buffer binds", &RenderStats::uniform_buffer_binds},
+    {"Uniform uploads", &RenderStats::uniform_uploads},
+    {"Uniform upload bytes", &RenderStats::uniform_upload_bytes},
+    {"Buffer upload bytes", &RenderStats::buffer_upload_bytes},
+    {"Texture upload bytes", &RenderStats::texture_upload_bytes},
+}};
+
+void RenderStatsHistory::end_frame() {
+    frames[next] = render_stats;
+    next = (next + 1) % frame_count;
+    count = std::min(count + 1, frame_count);
+    render_stats = RenderStats();
+}
+
+const RenderStats &RenderStatsHistory::get_last_frame() const {
+    return frames[(next + frame_count - 1) % frame_count];
+}
+
+RenderStatsHistory::Summary RenderStatsHistory::summarize(uint64_t RenderStats::*value) const {
+    Summary summary;
+    if (count == 0) return summary;
+
+    summary.min = UINT64_MAX;
+    double total = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        const uint64_t frame_value = frames[i].*value;
+        summary.min = std::min(summary.min, frame_value);
+        summary.max = std::max(summary.max, frame_value);
+        total += static_cast<double>(frame_value);
+    }
+    summary.average = total / static_cast<double>(count);
+    return summary;
+}
@@ -0,0 +1,40 @@
+#include "sampler_cache.hpp"
+#include "gl_extensions.hpp"
+#include "engine_config.hpp"
+
+#include <algorithm>
+
+std::vector<std::pair<SamplerSettings, GLuint>> SamplerCache::samplers;
+
+GLuint SamplerCache::get(const SamplerSettings &settings) {
+    SamplerSettings resolved = settings;
+    if (resolved.anisotropy <= 0.0f) resolved.anisotropy = config.max_anisotropy;
+    resolved.anisotropy = gl_extensions.texture_filter_anisotropic
+        ? std::clamp(resolved.anisotropy, 1.0f, gl_extensions.max_anisotropy)
+        : 1.0f;
+
+    for (const auto &[key, sampler] : samplers) {
+        if (key == resolved) return sampler;
+    }
+
+    GLuint sampler = 0;
+    glGenSamplers(1, &sampler);
+    glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, resolved.min_filter);
+    glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, resolved.mag_filter);
+    glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, resolved.wrap);
+    glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, resolved.wrap);
+    glSamplerParameteri(sampler, GL_TEXTURE_WRAP_R, resolved.wrap);
+    if (resolved.anisotropy > 1.0f) {
+        glSamplerParameterf(sampler, GL_TEXTURE_MAX_ANISOTROPY, resolved.anisotropy);
+    }
+
+    samplers.push_back({resolved, sampler});
+    return sampler;
+}
+
+void SamplerCache::shutdown() {
+    for (const auto &[key, sampler] : samplers) {
+        glDeleteSamplers(1, &sampler);
+    }
+    samplers.clear();
+}
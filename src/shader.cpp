@@ -1,91 +1,415 @@
 #include "shader.hpp"
+#include "engine_config.hpp"
+#include "gl_extensions.hpp"
+#include "utils.hpp"
+#include "asset_pack.hpp"
+#include "profiler.hpp"
 
-Shader::Shader(const std::string &directory) {
-    const std::string vertex_path = directory + "/vertex.glsl";
-    const std::string fragment_path = directory + "/fragment.glsl";
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+namespace {
+    const uint32_t binary_magic = 0x48535042; // "BPSH"
+
+    struct BinaryHeader {
+        uint32_t magic;
+        uint32_t format;
+        uint64_t key;
+        uint64_t size;
+    };
 
-    bool success = load(vertex_path, fragment_path);
-    if (!success) {
-        std::cerr << "Shader failed to initialize\n";
+    // From the mounted AssetPack when it has the file, else from disk.
+    bool read_source_file(const std::string &path, std::string &text) {
+        AssetBytes packed;
+        if (AssetPack::read_mounted(path, packed)) {
+            text.assign(reinterpret_cast<const char *>(packed.data), packed.size);
+            return true;
+        }
+
+        std::ifstream file(path);
+        if (!file.is_open()) return false;
+        std::stringstream stream;
+        stream << file.rdbuf();
+        text = stream.str();
+        return true;
     }
-}
 
-Shader::Shader(const std::string &vertex_path, const std::string &fragment_path) {
-    bool success = load(vertex_path, fragment_path);
-    
-    if (!success) {
-        std::cerr << "Shader failed to initialize\n";
+    // Linked programs by the hash of their final source, shared by every
+    // Shader and variant that ends up with identical GLSL. A program is
+    // deleted once the last variant using it is released.
+    struct SharedProgram {
+        GLuint program;
+        uint32_t users;
+    };
+    std::unordered_map<uint64_t, SharedProgram> programs;
+
+    const char *get_gl_string(GLenum name) {
+        const char *value = reinterpret_cast<const char *>(glGetString(name));
+        return value ? value : "";
+    }
+
+    // Binaries only load on the driver that produced them.
+    uint64_t get_driver_hash() {
+        static const uint64_t hash = [] {
+            const std::string driver = std::string(get_gl_string(GL_VENDOR)) + "|" +
+                                       get_gl_string(GL_RENDERER) + "|" + get_gl_string(GL_VERSION);
+            return hash_bytes(driver.data(), driver.size());
+        }();
+        return hash;
+    }
+
+    uint64_t get_binary_key(uint64_t source_hash) {
+        return hash_bytes(&source_hash, sizeof(source_hash), get_driver_hash());
+    }
+
+    bool use_binary_cache() {
+        return config.shader_binary_cache && gl_extensions.program_binary;
+    }
+
+    std::vector<std::string> parse_keywords(const ShaderSource &source) {
+        std::vector<std::string> keywords;
+        for (const std::string *code : {&source.vertex, &source.fragment}) {
+            std::istringstream lines(*code);
+            std::string line;
+            while (std::getline(lines, line)) {
+                std::istringstream tokens(line);
+                std::string directive, pragma, keyword;
+                tokens >> directive >> pragma;
+                if (directive != "#pragma" || pragma != "keywords") continue;
+                while (tokens >> keyword) {
+                    if (std::find(keywords.begin(), keywords.end(), keyword) == keywords.end()) keywords.push_back(keyword);
+                }
+            }
+        }
+        return keywords;
+    }
+
+    // #defines must follow #version, which has to come first.
+    std::string inject_defines(const std::string &code, const std::string &defines) {
+        if (defines.empty()) return code;
+        const size_t version = code.find("#version");
+        if (version == std::string::npos) return defines + code;
+        const size_t line_end = code.find('\n', version);
+        if (line_end == std::string::npos) return code + "\n" + defines;
+        return code.substr(0, line_end + 1) + defines + code.substr(line_end + 1);
+    }
+
+    std::string get_binary_path(uint64_t source_hash) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(get_binary_key(source_hash)));
+        return (std::filesystem::path(config.shader_cache_dir) / name).string();
+    }
+
+    GLuint compile_program(const ShaderSource &source) {
+        const char *vertex_shader_code = source.vertex.c_str();
+        const char *fragment_shader_code = source.fragment.c_str();
+
+        GLuint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertex_shader, 1, &vertex_shader_code, NULL);
+        glCompileShader(vertex_shader);
+
+        int success;
+        char info_log[512];
+        glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            glGetShaderInfoLog(vertex_shader, 512, NULL, info_log);
+            std::cerr << "ERROR::SHADER::VERTEX::COMPILATIO_FAILED\n" << info_log << "\n";
+            glDeleteShader(vertex_shader);
+            return 0;
+        }
+
+        GLuint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragment_shader, 1, &fragment_shader_code, NULL);
+        glCompileShader(fragment_shader);
+
+        glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            glGetShaderInfoLog(fragment_shader, 512, NULL, info_log);
+            std::cerr << "ERROR::SHADER::FRAGMENT::COMPILATIO_FAILED\n" << info_log << "\n";
+            glDeleteShader(vertex_shader);
+            glDeleteShader(fragment_shader);
+            return 0;
+        }
+
+        GLuint program = glCreateProgram();
+        glAttachShader(program, vertex_shader);
+        glAttachShader(program, fragment_shader);
+        if (use_binary_cache()) {
+            gl_extensions.program_parameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        glLinkProgram(program);
+
+        glDeleteShader(vertex_shader);
+        glDeleteShader(fragment_shader);
+
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            glGetProgramInfoLog(program, 512, NULL, info_log);
+            std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << info_log << "\n";
+            glDeleteProgram(program);
+            return 0;
+        }
+
+        return program;
+    }
+
+    // Linked programs are cached in config.shader_cache_dir, keyed by source
+    // hash and driver so a driver update falls back to compiling from source.
+    GLuint load_program_binary(uint64_t source_hash) {
+        const std::string path = get_binary_path(source_hash);
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) return 0;
+
+        BinaryHeader header{};
+        file.read(reinterpret_cast<char *>(&header), sizeof(header));
+        if (!file || header.magic != binary_magic || header.key != get_binary_key(source_hash)) return 0;
+
+        std::vector<char> binary(header.size);
+        file.read(binary.data(), static_cast<std::streamsize>(binary.size()));
+        if (!file) return 0;
+
+        GLuint program = glCreateProgram();
+        gl_extensions.program_binary_load(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+
+        // Drivers may reject a binary even for the same version string; compile instead.
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            glDeleteProgram(program);
+            std::cerr << "Shader: cached binary " << path << " rejected, compiling from source\n";
+            return 0;
+        }
+        return program;
+    }
+
+    void save_program_binary(GLuint program, uint64_t source_hash) {
+        GLint size = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+        if (size <= 0) return;
+
+        std::vector<char> binary(size);
+        GLenum format = 0;
+        gl_extensions.get_program_binary(program, size, nullptr, &format, binary.data());
+
+        std::error_code error;
+        std::filesystem::create_directories(config.shader_cache_dir, error);
+
+        const std::string path = get_binary_path(source_hash);
+        std::ofstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Shader: could not write binary cache " << path << "\n";
+            return;
+        }
+
+        const BinaryHeader header{binary_magic, format, get_binary_key(source_hash), binary.size()};
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+    }
+
+    void bind_uniform_blocks(GLuint program) {
+        const GLuint frame_block = glGetUniformBlockIndex(program, "FrameData");
+        if (frame_block != GL_INVALID_INDEX) glUniformBlockBinding(program, frame_block, Shader::frame_block_binding);
+        const GLuint material_block = glGetUniformBlockIndex(program, "MaterialParams");
+        if (material_block != GL_INVALID_INDEX) glUniformBlockBinding(program, material_block, Shader::material_block_binding);
     }
-}
 
-bool Shader::load(const std::string &vertex_path, const std::string &fragment_path) {
-    std::ifstream vertex_file(vertex_path);
-    std::ifstream fragment_file(fragment_path);
+    std::shared_ptr<const ParameterLayout> reflect_parameters(GLuint program) {
+        auto layout = std::make_shared<ParameterLayout>();
+        const GLuint block = program ? glGetUniformBlockIndex(program, "MaterialParams") : GL_INVALID_INDEX;
+        if (block == GL_INVALID_INDEX) return layout;
 
-    if (!vertex_file.is_open()) {
+        GLint size = 0, count = 0;
+        glGetActiveUniformBlockiv(program, block, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+        glGetActiveUniformBlockiv(program, block, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &count);
+        std::vector<GLint> block_indices(count);
+        glGetActiveUniformBlockiv(program, block, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES, block_indices.data());
+
+        const std::vector<GLuint> indices(block_indices.begin(), block_indices.end());
+        std::vector<GLint> offsets(count), types(count);
+        glGetActiveUniformsiv(program, count, indices.data(), GL_UNIFORM_OFFSET, offsets.data());
+        glGetActiveUniformsiv(program, count, indices.data(), GL_UNIFORM_TYPE, types.data());
+
+        // Members of material_slots[0] describe a slot; the highest index
+        // seen gives the slot count. Plain members make a single slot.
+        const std::string slot_prefix = "material_slots[";
+        GLuint slot_count = 1;
+        for (GLint i = 0; i < count; ++i) {
+            char name[256];
+            glGetActiveUniformName(program, indices[i], sizeof(name), nullptr, name);
+            std::string parameter_name = name;
+            if (parameter_name.rfind(slot_prefix, 0) == 0) {
+                const size_t close = parameter_name.find("].", slot_prefix.size());
+                if (close == std::string::npos) continue;
+                const GLuint slot = static_cast<GLuint>(std::stoul(parameter_name.substr(slot_prefix.size(), close - slot_prefix.size())));
+                slot_count = std::max(slot_count, slot + 1);
+                if (slot != 0) continue;
+                parameter_name = parameter_name.substr(close + 2);
+            }
+            layout->parameters.push_back({parameter_name, static_cast<GLenum>(types[i]), static_cast<GLuint>(offsets[i])});
+        }
+        layout->size = static_cast<GLuint>(size) / slot_count;
+        layout->slot_count = slot_count;
+        return layout;
+    }
+
+    // Reuses a program with the same source, else links from the binary cache,
+    // else compiles and refreshes the cache. Each nonzero result holds a
+    // reference to source_hash's program until release_program.
+    GLuint build_program(const ShaderSource &source, uint64_t &source_hash) {
+        PROFILE_SCOPE("Shader::build_program");
+        source_hash = source.get_hash();
+        if (auto it = programs.find(source_hash); it != programs.end()) {
+            it->second.users++;
+            return it->second.program;
+        }
+
+        GLuint program = use_binary_cache() ? load_program_binary(source_hash) : 0;
+        if (!program) {
+            program = compile_program(source);
+            if (!program) return 0;
+            if (use_binary_cache()) save_program_binary(program, source_hash);
+        }
+        bind_uniform_blocks(program);
+
+        programs[source_hash] = {program, 1};
+        return program;
+    }
+
+    void release_program(uint64_t source_hash) {
+        auto it = programs.find(source_hash);
+        if (it == programs.end() || --it->second.users > 0) return;
+        glDeleteProgram(it->second.program);
+        programs.erase(it);
+    }
+}
+
+bool ShaderSource::read(const std::string &vertex_path, const std::string &fragment_path) {
+    PROFILE_SCOPE("ShaderSource::read");
+    if (!read_source_file(vertex_path, vertex)) {
         std::cerr << "Failed to load vertex shader " << vertex_path << "\n";
         return false;
     }
 
-    if (!fragment_file.is_open()) {
+    if (!read_source_file(fragment_path, fragment)) {
         std::cerr << "Failed to load fragment shader " << fragment_path << "\n";
         return false;
     }
 
-    std::stringstream vertex_stream, fragment_stream;
-    vertex_stream << vertex_file.rdbuf();
-    fragment_stream << fragment_file.rdbuf();
+    this->vertex_path = vertex_path;
+    this->fragment_path = fragment_path;
+    return true;
+}
 
-    std::string vertex_code = vertex_stream.str();
-    std::string fragment_code = fragment_stream.str();
+bool ShaderSource::read(const std::string &directory) {
+    return read(directory + "/vertex.glsl", directory + "/fragment.glsl");
+}
 
-    const char *vertex_shader_code = vertex_code.c_str();
-    const char *fragment_shader_code = fragment_code.c_str();
+uint64_t ShaderSource::get_hash() const {
+    const uint64_t vertex_hash = hash_bytes(vertex.data(), vertex.size());
+    return hash_bytes(fragment.data(), fragment.size(), hash_bytes(&vertex_hash, sizeof(vertex_hash)));
+}
 
-    GLuint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex_shader, 1, &vertex_shader_code, NULL);
-    glCompileShader(vertex_shader);
+Shader::Shader(const std::string &directory) {
+    if (source.read(directory)) init();
+    if (!program) std::cerr << "Shader failed to initialize\n";
+}
 
-    int success;
-    char info_log[512];
-    glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(vertex_shader, 512, NULL, info_log);
-        std::cerr << "ERROR::SHADER::VERTEX::COMPILATIO_FAILED\n" << info_log << "\n";
-        return false;
+Shader::Shader(const std::string &vertex_path, const std::string &fragment_path) {
+    if (source.read(vertex_path, fragment_path)) init();
+    if (!program) std::cerr << "Shader failed to initialize\n";
+}
+
+Shader::Shader(const ShaderSource &shader_source) : source(shader_source) {
+    if (!source.vertex.empty() && !source.fragment.empty()) init();
+    if (!program) std::cerr << "Shader failed to initialize\n";
+}
+
+Shader::~Shader() {
+    release_variants();
+}
+
+Shader::Shader(Shader &&other) noexcept {
+    *this = std::move(other);
+}
+
+Shader &Shader::operator=(Shader &&other) noexcept {
+    if (this == &other) return *this;
+    release_variants();
+    source = std::move(other.source);
+    source_hash = other.source_hash;
+    keywords = std::move(other.keywords);
+    variants = std::move(other.variants);
+    program = other.program;
+    generation = other.generation;
+    other.variants.clear();
+    other.program = 0;
+    return *this;
+}
+
+void Shader::release_variants() {
+    for (const auto &[mask, variant] : variants) {
+        if (variant.program) release_program(variant.program_hash);
     }
+    variants.clear();
+    program = 0;
+}
 
-    GLuint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment_shader, 1, &fragment_shader_code, NULL);
-    glCompileShader(fragment_shader);
+void Shader::shutdown() {
+    for (const auto &[hash, shared] : programs) glDeleteProgram(shared.program);
+    programs.clear();
+}
 
-    glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragment_shader, 512, NULL, info_log);
-        std::cerr << "ERROR::SHADER::FRAGMENT::COMPILATIO_FAILED\n" << info_log << "\n";
-        return false;
+void Shader::init() {
+    source_hash = source.get_hash();
+    keywords = parse_keywords(source);
+    if (keywords.size() > 32) {
+        std::cerr << "Shader: only the first 32 keywords get variants\n";
+        keywords.resize(32);
     }
+    program = get_program(0);
+}
 
-    program = glCreateProgram();
-    glAttachShader(program, vertex_shader);
-    glAttachShader(program, fragment_shader);
-    glLinkProgram(program);
+GLuint Shader::get_program(uint32_t variant) {
+    if (auto it = variants.find(variant); it != variants.end()) return it->second.program;
 
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(program, 512, NULL, info_log);
-        std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << info_log << "\n";
-        return false;
+    std::string defines;
+    for (size_t i = 0; i < keywords.size(); ++i) {
+        if (variant & (1u << i)) defines += "#define " + keywords[i] + "\n";
     }
+    uint64_t program_hash = 0;
+    const GLuint variant_program = build_program({inject_defines(source.vertex, defines), inject_defines(source.fragment, defines), source.vertex_path, source.fragment_path}, program_hash);
+    variants[variant] = {variant_program, program_hash, reflect_parameters(variant_program)};
+    return variant_program;
+}
+
+std::shared_ptr<const ParameterLayout> Shader::get_layout(uint32_t variant) {
+    get_program(variant);
+    return variants[variant].layout;
+}
+
+bool Shader::reload(const ShaderSource &new_source) {
+    if (new_source.get_hash() == source_hash) return true;
+
+    // The rebuilt variants take their references before the old ones are
+    // released, so programs the edit did not change are not relinked.
+    Shader rebuilt(new_source);
+    if (!rebuilt.program) return false;
 
-    glDeleteShader(vertex_shader);
-    glDeleteShader(fragment_shader);
-    
+    const uint32_t next_generation = generation + 1;
+    *this = std::move(rebuilt);
+    generation = next_generation;
     return true;
 }
 
+int Shader::get_keyword_index(const std::string &keyword) const {
+    for (size_t i = 0; i < keywords.size(); ++i) {
+        if (keywords[i] == keyword) return static_cast<int>(i);
+    }
+    return -1;
+}
+
 void Shader::use() const { 
     glUseProgram(program); 
 }
-
-
@@ -6,34 +6,42 @@ in vec3 FragPos;
 in vec3 Normal;
 in vec3 Tangent;
 in vec3 Bitangent;
+flat in vec4 Tint;
+flat in int ParameterSlot;
+
+layout(std140) uniform FrameData { // see FrameUniforms
+    mat4 projection;
+    mat4 view;
+    vec3 view_position;
+    vec3 light_direction;
+    vec3 light_ambient;
+    vec3 light_diffuse;
+    vec3 light_specular;
+};
 
-struct Material {
+struct MaterialSlot {
     vec3 base_color;
 };
 
-struct Light {
-    vec3 direction;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
+// The material's values and its instances', each draw picking its own.
+layout(std140) uniform MaterialParams {
+    MaterialSlot material_slots[64];
 };
 
-uniform Material material;
-uniform Light light;
-uniform vec3 viewPos;
-
 void main()
 {
+    MaterialSlot material = material_slots[ParameterSlot];
+
     vec3 normal = normalize(Normal);
 
-    vec3 color = material.base_color;
-    vec3 ambient = light.ambient * color;
+    vec3 color = material.base_color * Tint.rgb;
+    vec3 ambient = light_ambient * color;
 
 
     // Diffuse
-    vec3 lightDir = normalize(-light.direction);
+    vec3 lightDir = normalize(-light_direction);
     float diff = max(dot(normal, lightDir), 0.0);
-    vec3 diffuse = light.diffuse * diff * color;
+    vec3 diffuse = light_diffuse * diff * color;
 
-    FragColor = vec4(ambient + diffuse, 1.0);
+    FragColor = vec4(ambient + diffuse, Tint.a);
 }
\ No newline at end of file
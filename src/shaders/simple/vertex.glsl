@@ -1,27 +1,42 @@
 #version 330 core
 layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec3 aNormal;
-layout(location = 2) in vec2 aTexCoords;
-layout(location = 3) in vec3 aTangent;
-layout(location = 4) in vec3 aBitangent;
+layout(location = 2) in vec4 aTangent; // w: bitangent handedness
+layout(location = 3) in vec2 aTexCoords;
+layout(location = 5) in mat4 aTransform; // per draw, see RenderQueue
+layout(location = 10) in vec2 aDrawIndices; // texture layer, material slot
+layout(location = 11) in mat3 aNormalMatrix;
+layout(location = 14) in vec4 aTint;
+layout(location = 15) in vec4 aCustom; // unused here; for shaders that want per-object values
 
 out vec2 TexCoords;
 out vec3 FragPos;
 out vec3 Normal;
 out vec3 Tangent;
 out vec3 Bitangent;
+flat out vec4 Tint;
+flat out int ParameterSlot;
 
-uniform mat4 transform;
-uniform mat4 view;
-uniform mat4 projection;
+layout(std140) uniform FrameData { // see FrameUniforms
+    mat4 projection;
+    mat4 view;
+    vec3 view_position;
+    vec3 light_direction;
+    vec3 light_ambient;
+    vec3 light_diffuse;
+    vec3 light_specular;
+};
 
 void main()
 {
+    mat4 transform = aTransform;
     TexCoords = aTexCoords;
+    Tint = aTint;
+    ParameterSlot = int(aDrawIndices.y);
     FragPos = vec3(transform * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(transform))) * aNormal;
-    Tangent = mat3(transpose(inverse(transform))) * aTangent;
-    Bitangent = mat3(transpose(inverse(transform))) * aBitangent;
+    Normal = aNormalMatrix * aNormal;
+    Tangent = mat3(transform) * aTangent.xyz;
+    Bitangent = cross(Normal, Tangent) * aTangent.w;
 
     gl_Position = projection * view * vec4(FragPos, 1.0);
-}
\ No newline at end of file
+}
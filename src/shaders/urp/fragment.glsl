@@ -1,4 +1,5 @@
 #version 330 core
+#pragma keywords USE_BASE_MAP USE_BASE_MAP_ARRAY USE_NORMAL_MAP USE_OCCLUSION_MAP USE_METALLIC_MAP
 out vec4 FragColor;
 
 in vec2 TexCoords;
@@ -6,78 +7,112 @@ in vec3 FragPos;
 in vec3 Normal;
 in vec3 Tangent;
 in vec3 Bitangent;
+flat in vec4 Tint;
+in vec4 TextureRect;
+flat in float TextureLayer;
+flat in int ParameterSlot;
 
-struct Material {
+layout(std140) uniform FrameData { // see FrameUniforms
+    mat4 projection;
+    mat4 view;
+    vec3 view_position;
+    vec3 light_direction;
+    vec3 light_ambient;
+    vec3 light_diffuse;
+    vec3 light_specular;
+};
+
+struct MaterialSlot {
     vec3 base_color;
-    sampler2D base_map;
-    sampler2D metallic_map;
-    sampler2D normal_map;
-    sampler2D occlusion_map;
     float smoothness;
 };
 
-struct Light {
-    vec3 direction;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
+// The material's values and its instances', each draw picking its own.
+layout(std140) uniform MaterialParams {
+    MaterialSlot material_slots[64];
 };
 
-uniform Material material;
-uniform Light light;
-uniform vec3 viewPos;
-
-uniform bool use_base_map;
-uniform bool use_normal_map;
-uniform bool use_occlusion_map;
+// Each map is only declared, and sampled, in the variants that set it.
+#ifdef USE_BASE_MAP
+uniform sampler2D base_map;
+#endif
+#ifdef USE_BASE_MAP_ARRAY
+uniform sampler2DArray base_map_array; // packed base map, see TextureLayer
+#endif
+#ifdef USE_METALLIC_MAP
+uniform sampler2D metallic_map;
+#endif
+#ifdef USE_NORMAL_MAP
+uniform sampler2D normal_map;
+#endif
+#ifdef USE_OCCLUSION_MAP
+uniform sampler2D occlusion_map;
+#endif
 
 void main()
 {
+    MaterialSlot material = material_slots[ParameterSlot];
+
     // --- Normal Calculation ---
     vec3 normal = normalize(Normal);
-    if (use_normal_map) {
+#ifdef USE_NORMAL_MAP
+    {
         vec3 T = normalize(Tangent);
         vec3 B = normalize(Bitangent);
         vec3 N = normalize(Normal);
         mat3 TBN = mat3(T, B, N);
 
-        vec3 normalSample = texture(material.normal_map, TexCoords).rgb;
-        normalSample = normalize(normalSample * 2.0 - 1.0);
+        // Only xy is read so two-channel (BC5) normal maps work; z is rebuilt.
+        vec2 normalXY = texture(normal_map, TexCoords).rg * 2.0 - 1.0;
+        vec3 normalSample = vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0)));
         normal = normalize(TBN * normalSample);
     }
+#endif
 
     // --- Base Color ---
-    vec3 color = material.base_color;
-    if (use_base_map) {
-        vec4 baseTex = texture(material.base_map, TexCoords);
-        color *= baseTex.rgb;
+    vec3 color = material.base_color * Tint.rgb;
+#ifdef USE_BASE_MAP
+    color *= texture(base_map, TexCoords).rgb;
+#endif
+#ifdef USE_BASE_MAP_ARRAY
+    if (TextureLayer >= 0.0) {
+        // Repeat inside the packed rect; gradients come from the unwrapped
+        // UVs so the wrap does not pick the coarsest mip along the seam.
+        vec2 uv = TextureRect.xy + fract(TexCoords) * TextureRect.zw;
+        vec2 dx = dFdx(TexCoords) * TextureRect.zw;
+        vec2 dy = dFdy(TexCoords) * TextureRect.zw;
+        color *= textureGrad(base_map_array, vec3(uv, TextureLayer), dx, dy).rgb;
     }
+#endif
 
     // --- Metallic ---
-    float metallic = texture(material.metallic_map, TexCoords).r;
+    float metallic = 0.0;
+#ifdef USE_METALLIC_MAP
+    metallic = texture(metallic_map, TexCoords).r;
+#endif
 
     // --- Occlusion ---
     float occlusion = 1.0;
-    if (use_occlusion_map) {
-        occlusion = texture(material.occlusion_map, TexCoords).r;
-    }
+#ifdef USE_OCCLUSION_MAP
+    occlusion = texture(occlusion_map, TexCoords).r;
+#endif
 
     // --- Lighting ---
-    vec3 lightDir = normalize(-light.direction);
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 lightDir = normalize(-light_direction);
+    vec3 viewDir = normalize(view_position - FragPos);
     vec3 reflectDir = reflect(-lightDir, normal);
 
     // Ambient
-    vec3 ambient = light.ambient * color * occlusion;
+    vec3 ambient = light_ambient * color * occlusion;
 
     // Diffuse
     float diff = max(dot(normal, lightDir), 0.0);
-    vec3 diffuse = light.diffuse * diff * color;
+    vec3 diffuse = light_diffuse * diff * color;
 
     // Specular (simple PBR-inspired Fresnel)
     vec3 specColor = mix(vec3(0.04), color, metallic);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.smoothness);
-    vec3 specular = light.specular * spec * specColor;
+    vec3 specular = light_specular * spec * specColor;
 
-    FragColor = vec4(ambient + diffuse + specular, 1.0);
+    FragColor = vec4(ambient + diffuse + specular, Tint.a);
 }
@@ -0,0 +1,133 @@
+#include "texture_array.hpp"
+#include "render_stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    int mip_count_of(int width, int height) {
+        return static_cast<int>(std::floor(std::log2(std::max(width, height)))) + 1;
+    }
+}
+
+TextureArray::TextureArray(int width, int height, const TextureSettings &settings, int initial_capacity)
+    : width(width), height(height), settings(settings) {
+    allocate(std::max(1, initial_capacity));
+}
+
+TextureArray::~TextureArray() {
+    glDeleteTextures(1, &id);
+}
+
+// (Re)creates storage for capacity layers, copying the existing layers'
+// base level through a read framebuffer since GL 3.3 has no glCopyImageSubData.
+void TextureArray::allocate(int capacity) {
+    GLuint new_id = 0;
+    glGenTextures(1, &new_id);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, new_id);
+
+    const GLint internal_format = settings.color_space == ColorSpace::SRGB ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+    const int mip_count = mip_count_of(width, height);
+    for (int level = 0; level < mip_count; ++level) {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, level, internal_format,
+                     std::max(1, width >> level), std::max(1, height >> level), capacity,
+                     0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+
+    if (id && layer_count > 0) {
+        GLuint framebuffer = 0;
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        for (int layer = 0; layer < layer_count; ++layer) {
+            glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, id, 0, layer);
+            glCopyTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, 0, 0, width, height);
+        }
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &framebuffer);
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    }
+
+    if (id) glDeleteTextures(1, &id);
+    id = new_id;
+    layer_capacity = capacity;
+}
+
+int TextureArray::add_layer() {
+    if (layer_count == layer_capacity) allocate(layer_capacity * 2);
+    return layer_count++;
+}
+
+void TextureArray::write(int layer, int x, int y, int region_width, int region_height, const unsigned char *rgba) {
+    glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, x, y, layer, region_width, region_height, 1,
+                    GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    render_stats.texture_upload_bytes += static_cast<size_t>(region_width) * region_height * 4;
+}
+
+void TextureArray::generate_mipmaps() {
+    glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+}
+
+void TextureArray::bind(GLenum unit) const {
+    glActiveTexture(unit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+}
+
+TextureAtlas::TextureAtlas(int page_size, int padding, const TextureSettings &settings)
+    : pages(std::make_shared<TextureArray>(page_size, page_size, settings, 1)), page_size(page_size), padding(padding) {}
+
+// Best-fitting existing shelf, else a new shelf under the last one.
+bool TextureAtlas::place(int page, int width, int height, int &x, int &y) {
+    auto &page_shelves = shelves[page];
+
+    Shelf *best = nullptr;
+    for (auto &shelf : page_shelves) {
+        if (shelf.height >= height && shelf.x + width <= page_size &&
+            (!best || shelf.height < best->height)) {
+            best = &shelf;
+        }
+    }
+
+    if (!best) {
+        const int top = page_shelves.empty() ? 0 : page_shelves.back().y + page_shelves.back().height;
+        if (top + height > page_size) return false;
+        page_shelves.push_back({top, height, 0});
+        best = &page_shelves.back();
+    }
+
+    x = best->x;
+    y = best->y;
+    best->x += width;
+    return true;
+}
+
+bool TextureAtlas::add(const TextureImage &image, TextureLayer &layer) {
+    const int padded_width = image.width + padding * 2;
+    const int padded_height = image.height + padding * 2;
+    if (image.channels != 4 || padded_width > page_size || padded_height > page_size) return false;
+
+    int page = -1, x = 0, y = 0;
+    for (int i = 0; i < static_cast<int>(shelves.size()) && page < 0; ++i) {
+        if (place(i, padded_width, padded_height, x, y)) page = i;
+    }
+    if (page < 0) {
+        page = pages->add_layer();
+        shelves.resize(page + 1);
+        place(page, padded_width, padded_height, x, y);
+    }
+
+    // The padding is left empty; it keeps neighbours apart when sampling
+    // the finer mips, though the coarsest mips still mix them.
+    pages->write(page, x + padding, y + padding, image.width, image.height, image.pixels.get());
+    pages->generate_mipmaps();
+
+    layer.array = pages;
+    layer.layer = page;
+    layer.rect = glm::vec4(
+        static_cast<float>(x + padding) / page_size,
+        static_cast<float>(y + padding) / page_size,
+        static_cast<float>(image.width) / page_size,
+        static_cast<float>(image.height) / page_size);
+    return true;
+}
@@ -0,0 +1,584 @@
+#include "texture_compression.hpp"
+#include "thread_pool.hpp"
+#include "asset_pack.hpp"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    using Block = std::array<uint8_t, 64>; // 4x4 RGBA texels
+
+    constexpr uint32_t make_fourcc(char a, char b, char c, char d) {
+        return uint32_t(uint8_t(a)) | uint32_t(uint8_t(b)) << 8 | uint32_t(uint8_t(c)) << 16 | uint32_t(uint8_t(d)) << 24;
+    }
+
+    constexpr uint32_t dds_magic = make_fourcc('D', 'D', 'S', ' ');
+
+    enum DXGIFormat : uint32_t {
+        DXGI_FORMAT_BC1_UNORM = 71,
+        DXGI_FORMAT_BC1_UNORM_SRGB = 72,
+        DXGI_FORMAT_BC3_UNORM = 77,
+        DXGI_FORMAT_BC3_UNORM_SRGB = 78,
+        DXGI_FORMAT_BC5_UNORM = 83,
+        DXGI_FORMAT_BC7_UNORM = 98,
+        DXGI_FORMAT_BC7_UNORM_SRGB = 99,
+    };
+
+    struct DDSPixelFormat {
+        uint32_t size, flags, fourcc, rgb_bit_count, r_mask, g_mask, b_mask, a_mask;
+    };
+
+    struct DDSHeader {
+        uint32_t size, flags, height, width, pitch_or_linear_size, depth, mip_map_count;
+        uint32_t reserved1[11];
+        DDSPixelFormat pixel_format;
+        uint32_t caps, caps2, caps3, caps4, reserved2;
+    };
+
+    struct DDSHeaderDX10 {
+        uint32_t dxgi_format, resource_dimension, misc_flag, array_size, misc_flags2;
+    };
+
+    static_assert(sizeof(DDSHeader) == 124, "DDS header must match the file layout");
+    static_assert(sizeof(DDSHeaderDX10) == 20, "DX10 header must match the file layout");
+
+    void write_u16(uint8_t *out, uint16_t value) {
+        out[0] = value & 0xff;
+        out[1] = value >> 8;
+    }
+
+    void write_u32(uint8_t *out, uint32_t value) {
+        for (int i = 0; i < 4; ++i) out[i] = (value >> (8 * i)) & 0xff;
+    }
+
+    // Finds the two texels furthest apart along the block's dominant axis,
+    // found by power iteration on the covariance of the first `channels` channels.
+    void find_extremes(const Block &block, int channels, int &low, int &high) {
+        float mean[4] = {};
+        for (int i = 0; i < 16; ++i)
+            for (int c = 0; c < channels; ++c) mean[c] += block[i * 4 + c] / 16.0f;
+
+        float covariance[4][4] = {};
+        for (int i = 0; i < 16; ++i) {
+            float d[4] = {};
+            for (int c = 0; c < channels; ++c) d[c] = block[i * 4 + c] - mean[c];
+            for (int a = 0; a < channels; ++a)
+                for (int b = 0; b < channels; ++b) covariance[a][b] += d[a] * d[b];
+        }
+
+        float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+        for (int iteration = 0; iteration < 8; ++iteration) {
+            float next[4] = {};
+            float largest = 0.0f;
+            for (int a = 0; a < channels; ++a) {
+                for (int b = 0; b < channels; ++b) next[a] += covariance[a][b] * axis[b];
+                largest = std::max(largest, std::abs(next[a]));
+            }
+            if (largest < 1e-6f) break; // flat block, any axis works
+            for (int a = 0; a < channels; ++a) axis[a] = next[a] / largest;
+        }
+
+        float min_t = FLT_MAX, max_t = -FLT_MAX;
+        low = high = 0;
+        for (int i = 0; i < 16; ++i) {
+            float t = 0.0f;
+            for (int c = 0; c < channels; ++c) t += (block[i * 4 + c] - mean[c]) * axis[c];
+            if (t < min_t) { min_t = t; low = i; }
+            if (t > max_t) { max_t = t; high = i; }
+        }
+    }
+
+    uint16_t to_565(const uint8_t *color) {
+        return uint16_t((color[0] * 31 + 127) / 255 << 11 | (color[1] * 63 + 127) / 255 << 5 | (color[2] * 31 + 127) / 255);
+    }
+
+    void from_565(uint16_t value, int *color) {
+        int r = (value >> 11) & 31, g = (value >> 5) & 63, b = value & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    }
+
+    // Always emits the four-colour mode (color0 > color1), which BC3 requires.
+    void encode_bc1(const Block &block, uint8_t *out) {
+        int low, high;
+        find_extremes(block, 3, low, high);
+
+        uint16_t color0 = to_565(&block[high * 4]);
+        uint16_t color1 = to_565(&block[low * 4]);
+        if (color0 < color1) std::swap(color0, color1);
+
+        uint32_t indices = 0;
+        if (color0 != color1) {
+            int palette[4][3];
+            from_565(color0, palette[0]);
+            from_565(color1, palette[1]);
+            for (int c = 0; c < 3; ++c) {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+
+            for (int i = 0; i < 16; ++i) {
+                int best = 0, best_error = INT_MAX;
+                for (int p = 0; p < 4; ++p) {
+                    int error = 0;
+                    for (int c = 0; c < 3; ++c) {
+                        int d = block[i * 4 + c] - palette[p][c];
+                        error += d * d;
+                    }
+                    if (error < best_error) { best_error = error; best = p; }
+                }
+                indices |= uint32_t(best) << (2 * i);
+            }
+        }
+
+        write_u16(out, color0);
+        write_u16(out + 2, color1);
+        write_u32(out + 4, indices);
+    }
+
+    // One channel, eight-value mode (alpha0 > alpha1).
+    void encode_bc4(const Block &block, int channel, uint8_t *out) {
+        uint8_t low = 255, high = 0;
+        for (int i = 0; i < 16; ++i) {
+            low = std::min(low, block[i * 4 + channel]);
+            high = std::max(high, block[i * 4 + channel]);
+        }
+
+        out[0] = high;
+        out[1] = low;
+
+        uint64_t indices = 0;
+        if (high != low) {
+            int palette[8] = {high, low};
+            for (int i = 1; i < 7; ++i) palette[i + 1] = ((7 - i) * high + i * low) / 7;
+
+            for (int i = 0; i < 16; ++i) {
+                int best = 0, best_error = INT_MAX;
+                for (int p = 0; p < 8; ++p) {
+                    int error = std::abs(block[i * 4 + channel] - palette[p]);
+                    if (error < best_error) { best_error = error; best = p; }
+                }
+                indices |= uint64_t(best) << (3 * i);
+            }
+        }
+
+        for (int b = 0; b < 6; ++b) out[2 + b] = (indices >> (8 * b)) & 0xff;
+    }
+
+    struct BitWriter {
+        uint8_t *out;
+        int position = 0;
+
+        void write(uint32_t value, int bits) {
+            for (int b = 0; b < bits; ++b, ++position) {
+                if ((value >> b) & 1) out[position >> 3] |= uint8_t(1 << (position & 7));
+            }
+        }
+    };
+
+    // BC7 mode 6: one subset, RGBA 7.7.7.7 endpoints with a p-bit each, 4-bit indices.
+    void encode_bc7(const Block &block, uint8_t *out) {
+        static const int weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+        int low, high;
+        find_extremes(block, 4, low, high);
+        const uint8_t *source[2] = {&block[low * 4], &block[high * 4]};
+
+        int endpoints[2][4];
+        int pbits[2];
+        for (int e = 0; e < 2; ++e) {
+            int best_error = INT_MAX;
+            for (int p = 0; p < 2; ++p) {
+                int quantized[4], error = 0;
+                for (int c = 0; c < 4; ++c) {
+                    quantized[c] = std::clamp((source[e][c] - p + 1) / 2, 0, 127);
+                    int d = ((quantized[c] << 1) | p) - source[e][c];
+                    error += d * d;
+                }
+                if (error < best_error) {
+                    best_error = error;
+                    pbits[e] = p;
+                    std::copy(quantized, quantized + 4, endpoints[e]);
+                }
+            }
+        }
+
+        int palette[16][4];
+        for (int w = 0; w < 16; ++w) {
+            for (int c = 0; c < 4; ++c) {
+                int e0 = (endpoints[0][c] << 1) | pbits[0];
+                int e1 = (endpoints[1][c] << 1) | pbits[1];
+                palette[w][c] = ((64 - weights[w]) * e0 + weights[w] * e1 + 32) >> 6;
+            }
+        }
+
+        int indices[16];
+        for (int i = 0; i < 16; ++i) {
+            int best = 0, best_error = INT_MAX;
+            for (int p = 0; p < 16; ++p) {
+                int error = 0;
+                for (int c = 0; c < 4; ++c) {
+                    int d = block[i * 4 + c] - palette[p][c];
+                    error += d * d;
+                }
+                if (error < best_error) { best_error = error; best = p; }
+            }
+            indices[i] = best;
+        }
+
+        // The first index is stored with an implicit zero high bit.
+        if (indices[0] & 8) {
+            std::swap(endpoints[0], endpoints[1]);
+            std::swap(pbits[0], pbits[1]);
+            for (int &index : indices) index = 15 - index;
+        }
+
+        std::memset(out, 0, 16);
+        BitWriter writer{out};
+        writer.write(1 << 6, 7);
+        for (int c = 0; c < 4; ++c)
+            for (int e = 0; e < 2; ++e) writer.write(endpoints[e][c], 7);
+        writer.write(pbits[0], 1);
+        writer.write(pbits[1], 1);
+        writer.write(indices[0], 3);
+        for (int i = 1; i < 16; ++i) writer.write(indices[i], 4);
+    }
+
+    void encode_block(BlockFormat format, const Block &block, uint8_t *out) {
+        switch (format) {
+            case BlockFormat::BC1:
+                encode_bc1(block, out);
+                break;
+            case BlockFormat::BC3:
+                encode_bc4(block, 3, out);
+                encode_bc1(block, out + 8);
+                break;
+            case BlockFormat::BC5:
+                encode_bc4(block, 0, out);
+                encode_bc4(block, 1, out + 8);
+                break;
+            case BlockFormat::BC7:
+                encode_bc7(block, out);
+                break;
+        }
+    }
+
+    void compress_level(BlockFormat format, const uint8_t *rgba, int width, int height, uint8_t *out) {
+        const int blocks_x = (width + 3) / 4;
+        const int blocks_y = (height + 3) / 4;
+        const size_t block_size = get_block_size(format);
+
+        parallel_for(blocks_y, [&](size_t begin, size_t end) {
+            Block block;
+            for (size_t by = begin; by < end; ++by) {
+                for (int bx = 0; bx < blocks_x; ++bx) {
+                    // Edge blocks repeat the last row/column.
+                    for (int y = 0; y < 4; ++y) {
+                        int sy = std::min(int(by) * 4 + y, height - 1);
+                        for (int x = 0; x < 4; ++x) {
+                            int sx = std::min(bx * 4 + x, width - 1);
+                            std::memcpy(&block[(y * 4 + x) * 4], &rgba[(size_t(sy) * width + sx) * 4], 4);
+                        }
+                    }
+                    encode_block(format, block, out + (by * blocks_x + bx) * block_size);
+                }
+            }
+        }, 4);
+    }
+
+    float srgb_to_linear(float value) {
+        return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float linear_to_srgb(float value) {
+        return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    }
+
+    uint8_t to_unorm8(float value) {
+        return uint8_t(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+
+    // 2x2 box filter. Normal maps are renormalized, sRGB colours averaged in linear light.
+    std::vector<uint8_t> downsample(const std::vector<uint8_t> &source, int width, int height, TextureRole role, bool srgb) {
+        const int next_width = std::max(1, width / 2);
+        const int next_height = std::max(1, height / 2);
+        std::vector<uint8_t> result(size_t(next_width) * next_height * 4);
+
+        parallel_for(next_height, [&](size_t begin, size_t end) {
+            for (size_t y = begin; y < end; ++y) {
+                for (int x = 0; x < next_width; ++x) {
+                    float sum[4] = {};
+                    for (int t = 0; t < 4; ++t) {
+                        int sx = std::min(x * 2 + (t & 1), width - 1);
+                        int sy = std::min(int(y) * 2 + (t >> 1), height - 1);
+                        const uint8_t *texel = &source[(size_t(sy) * width + sx) * 4];
+                        for (int c = 0; c < 4; ++c) {
+                            float value = texel[c] / 255.0f;
+                            if (role == TextureRole::NormalMap && c < 3) value = value * 2.0f - 1.0f;
+                            else if (srgb && c < 3) value = srgb_to_linear(value);
+                            sum[c] += value * 0.25f;
+                        }
+                    }
+
+                    uint8_t *texel = &result[(y * next_width + x) * 4];
+                    if (role == TextureRole::NormalMap) {
+                        float length = std::sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+                        if (length < 1e-6f) { sum[0] = sum[1] = 0.0f; sum[2] = length = 1.0f; }
+                        for (int c = 0; c < 3; ++c) texel[c] = to_unorm8(sum[c] / length * 0.5f + 0.5f);
+                    } else {
+                        for (int c = 0; c < 3; ++c) texel[c] = to_unorm8(srgb ? linear_to_srgb(sum[c]) : sum[c]);
+                    }
+                    texel[3] = to_unorm8(sum[3]);
+                }
+            }
+        }, 16);
+
+        return result;
+    }
+
+    bool format_from_dxgi(uint32_t dxgi_format, BlockFormat &format) {
+        switch (dxgi_format) {
+            case DXGI_FORMAT_BC1_UNORM:
+            case DXGI_FORMAT_BC1_UNORM_SRGB: format = BlockFormat::BC1; return true;
+            case DXGI_FORMAT_BC3_UNORM:
+            case DXGI_FORMAT_BC3_UNORM_SRGB: format = BlockFormat::BC3; return true;
+            case DXGI_FORMAT_BC5_UNORM: format = BlockFormat::BC5; return true;
+            case DXGI_FORMAT_BC7_UNORM:
+            case DXGI_FORMAT_BC7_UNORM_SRGB: format = BlockFormat::BC7; return true;
+            default: return false;
+        }
+    }
+
+    uint32_t dxgi_from_format(BlockFormat format) {
+        switch (format) {
+            case BlockFormat::BC1: return DXGI_FORMAT_BC1_UNORM;
+            case BlockFormat::BC3: return DXGI_FORMAT_BC3_UNORM;
+            case BlockFormat::BC5: return DXGI_FORMAT_BC5_UNORM;
+            case BlockFormat::BC7: return DXGI_FORMAT_BC7_UNORM;
+        }
+        return 0;
+    }
+
+    size_t level_size(BlockFormat format, int width, int height) {
+        return size_t((width + 3) / 4) * ((height + 3) / 4) * get_block_size(format);
+    }
+}
+
+BlockFormat choose_block_format(TextureRole role, bool has_alpha) {
+    switch (role) {
+        case TextureRole::NormalMap: return BlockFormat::BC5;
+        case TextureRole::Mask: return BlockFormat::BC7;
+        case TextureRole::BaseMap:
+        default: return has_alpha ? BlockFormat::BC3 : BlockFormat::BC1;
+    }
+}
+
+size_t get_block_size(BlockFormat format) {
+    return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+size_t get_mip_chain_size(BlockFormat format, int width, int height, int first_level, int end_level) {
+    size_t size = 0;
+    for (int level = first_level; level < end_level; ++level) {
+        size += level_size(format, std::max(1, width >> level), std::max(1, height >> level));
+    }
+    return size;
+}
+
+const char *get_block_format_name(BlockFormat format) {
+    switch (format) {
+        case BlockFormat::BC1: return "BC1";
+        case BlockFormat::BC3: return "BC3";
+        case BlockFormat::BC5: return "BC5";
+        case BlockFormat::BC7: return "BC7";
+    }
+    return "unknown";
+}
+
+CompressedImage compress_image(const uint8_t *rgba, int width, int height, TextureRole role, bool srgb) {
+    bool has_alpha = false;
+    for (size_t i = 0; i < size_t(width) * height && !has_alpha; ++i) has_alpha = rgba[i * 4 + 3] != 255;
+
+    CompressedImage image;
+    image.format = choose_block_format(role, has_alpha);
+    image.width = width;
+    image.height = height;
+
+    size_t offset = 0;
+    for (int w = width, h = height;; w = std::max(1, w / 2), h = std::max(1, h / 2)) {
+        size_t size = level_size(image.format, w, h);
+        image.levels.push_back({w, h, offset, size});
+        offset += size;
+        if (w == 1 && h == 1) break;
+    }
+    image.mip_count = static_cast<int>(image.levels.size());
+    image.data.resize(offset);
+
+    std::vector<uint8_t> level(rgba, rgba + size_t(width) * height * 4);
+    for (size_t i = 0; i < image.levels.size(); ++i) {
+        const auto &info = image.levels[i];
+        if (i > 0) level = downsample(level, image.levels[i - 1].width, image.levels[i - 1].height, role, srgb);
+        compress_level(image.format, level.data(), info.width, info.height, image.data.data() + info.offset);
+    }
+
+    return image;
+}
+
+bool write_dds(const std::string &path, const CompressedImage &image) {
+    if (image.levels.empty() || image.first_level != 0 || !image.has_last_level()) {
+        std::cerr << "write_dds: " << path << " needs the full mip chain\n";
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty()) std::filesystem::create_directories(parent, error);
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "write_dds: unable to open " << path << "\n";
+        return false;
+    }
+
+    DDSHeader header = {};
+    header.size = sizeof(DDSHeader);
+    header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; // caps, height, width, pixel format, mip count, linear size
+    header.height = image.get_height();
+    header.width = image.get_width();
+    header.pitch_or_linear_size = uint32_t(image.levels[0].size);
+    header.mip_map_count = uint32_t(image.levels.size());
+    header.pixel_format.size = sizeof(DDSPixelFormat);
+    header.pixel_format.flags = 0x4; // FourCC
+    header.pixel_format.fourcc = make_fourcc('D', 'X', '1', '0');
+    header.caps = 0x1000 | (image.levels.size() > 1 ? 0x400008 : 0); // texture, mipmap + complex
+
+    DDSHeaderDX10 header_dx10 = {};
+    header_dx10.dxgi_format = dxgi_from_format(image.format);
+    header_dx10.resource_dimension = 3; // TEXTURE2D
+    header_dx10.array_size = 1;
+
+    file.write(reinterpret_cast<const char *>(&dds_magic), sizeof(dds_magic));
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(&header_dx10), sizeof(header_dx10));
+    file.write(reinterpret_cast<const char *>(image.data.data()), image.data.size());
+    return bool(file);
+}
+
+bool read_dds(const std::string &path, CompressedImage &image, int first_level, int end_level, int max_size) {
+    // From the mounted pack when it has the file, reading straight out of the mapping.
+    AssetBytes packed;
+    const bool from_pack = AssetPack::read_mounted(path, packed);
+    std::ifstream file;
+    if (!from_pack) {
+        file.open(path, std::ios::binary);
+        if (!file) return false;
+    }
+
+    size_t position = 0;
+    auto read = [&](void *destination, size_t size) {
+        if (!from_pack) {
+            file.read(reinterpret_cast<char *>(destination), std::streamsize(size));
+            return bool(file);
+        }
+        if (position > packed.size || packed.size - position < size) return false;
+        std::memcpy(destination, packed.data + position, size);
+        position += size;
+        return true;
+    };
+
+    uint32_t magic = 0;
+    DDSHeader header = {};
+    const bool has_header = read(&magic, sizeof(magic)) && read(&header, sizeof(header));
+    if (!has_header || magic != dds_magic || header.size != sizeof(DDSHeader)) {
+        std::cerr << "read_dds: " << path << " is not a DDS file\n";
+        return false;
+    }
+
+    bool known_format = true;
+    const uint32_t fourcc = header.pixel_format.fourcc;
+    if (fourcc == make_fourcc('D', 'X', '1', '0')) {
+        DDSHeaderDX10 header_dx10 = {};
+        known_format = read(&header_dx10, sizeof(header_dx10)) && format_from_dxgi(header_dx10.dxgi_format, image.format);
+    } else if (fourcc == make_fourcc('D', 'X', 'T', '1')) {
+        image.format = BlockFormat::BC1;
+    } else if (fourcc == make_fourcc('D', 'X', 'T', '5')) {
+        image.format = BlockFormat::BC3;
+    } else if (fourcc == make_fourcc('A', 'T', 'I', '2') || fourcc == make_fourcc('B', 'C', '5', 'U')) {
+        image.format = BlockFormat::BC5;
+    } else {
+        known_format = false;
+    }
+
+    if (!known_format) {
+        std::cerr << "read_dds: unsupported format in " << path << "\n";
+        return false;
+    }
+
+    image.width = int(header.width);
+    image.height = int(header.height);
+    image.mip_count = int(std::max(1u, header.mip_map_count));
+
+    if (end_level < 0 || end_level > image.mip_count) end_level = image.mip_count;
+    first_level = std::clamp(first_level, 0, end_level - 1);
+    if (max_size > 0) {
+        while (first_level < end_level - 1 &&
+               std::max(image.width >> first_level, image.height >> first_level) > max_size) {
+            ++first_level;
+        }
+    }
+    image.first_level = first_level;
+
+    // Mips are stored finest first, so skip the ones before first_level.
+    const size_t skipped = get_mip_chain_size(image.format, image.width, image.height, 0, first_level);
+    if (from_pack) {
+        position += skipped;
+    } else {
+        file.seekg(std::streamoff(skipped), std::ios::cur);
+    }
+
+    image.levels.clear();
+    size_t offset = 0;
+    for (int level = first_level; level < end_level; ++level) {
+        int width = std::max(1, image.width >> level);
+        int height = std::max(1, image.height >> level);
+        size_t size = level_size(image.format, width, height);
+        image.levels.push_back({width, height, offset, size});
+        offset += size;
+    }
+
+    image.data.resize(offset);
+    if (!read(image.data.data(), offset)) {
+        std::cerr << "read_dds: " << path << " is truncated\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool cook_texture(const std::string &source_path, const std::string &output_path, TextureRole role, bool srgb) {
+    int width, height, channels;
+    unsigned char *pixels = stbi_load(source_path.c_str(), &width, &height, &channels, 4);
+    if (!pixels) {
+        std::cerr << "cook_texture: failed to load " << source_path << "\n";
+        return false;
+    }
+
+    CompressedImage image = compress_image(pixels, width, height, role, srgb);
+    stbi_image_free(pixels);
+
+    if (!write_dds(output_path, image)) return false;
+
+    std::cout << source_path << " -> " << output_path << " (" << get_block_format_name(image.format) << ", "
+              << image.levels.size() << " mips, " << image.get_size() / 1024 << " KB)\n";
+    return true;
+}
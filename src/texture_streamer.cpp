@@ -0,0 +1,135 @@
+#include "texture_streamer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+void TextureStreamer::add(const std::shared_ptr<Texture> &texture, const std::string &path, const CompressedImage &tail) {
+    if (tail.first_level == 0) return; // small enough to be complete already
+
+    StreamedTexture entry{texture, path, tail.format, tail.get_width(), tail.get_height(), tail.first_level, tail.first_level};
+    entry.last_used_frame = frame;
+    entry.serial = next_serial++;
+    textures[texture.get()] = entry;
+}
+
+void TextureStreamer::remove(const Texture *texture) {
+    textures.erase(const_cast<Texture *>(texture));
+}
+
+// One texel per pixel: a texture drawn N pixels across wants the mip about N texels across.
+int TextureStreamer::get_wanted_level(const StreamedTexture &entry, float pixels) const {
+    if (pixels <= 0.0f) return entry.coarsest_level;
+
+    const float texels = static_cast<float>(std::max(entry.width, entry.height));
+    const int level = static_cast<int>(std::floor(std::log2(texels / pixels)));
+    return std::clamp(level, 0, entry.coarsest_level);
+}
+
+void TextureStreamer::request_levels(Texture *key, StreamedTexture &entry, int first_level, int end_level, bool replace) {
+    entry.in_flight = true;
+
+    workers.submit([this, key, serial = entry.serial, texture = entry.texture, path = entry.path, first_level, end_level, replace]() {
+        LoadedLevels result{key, serial, texture, CompressedImage(), replace, false};
+        result.success = read_dds(path, result.image, first_level, end_level);
+
+        std::lock_guard<std::mutex> lock(loaded_mutex);
+        loaded.push_back(std::move(result));
+    });
+}
+
+size_t TextureStreamer::apply_loaded(size_t budget_bytes) {
+    size_t bytes_sent = 0;
+    size_t applied = 0;
+    while (bytes_sent < budget_bytes || applied == 0) {
+        LoadedLevels result;
+        {
+            std::lock_guard<std::mutex> lock(loaded_mutex);
+            if (loaded.empty()) break;
+            result = std::move(loaded.front());
+            loaded.pop_front();
+        }
+
+        auto texture = result.texture.lock();
+        auto it = textures.find(result.key);
+        if (!texture || it == textures.end() || it->second.serial != result.serial) continue;
+
+        StreamedTexture &entry = it->second;
+        entry.in_flight = false;
+        entry.pending_bytes = 0;
+        if (!result.success) {
+            std::cerr << "TextureStreamer: failed to read mips from " << entry.path << "\n";
+            continue;
+        }
+
+        if (result.replace) texture->reset_storage();
+        texture->upload(result.image);
+        bytes_sent += result.image.get_size();
+        applied++;
+    }
+
+    return applied;
+}
+
+void TextureStreamer::update(size_t upload_budget_bytes, size_t vram_budget_bytes) {
+    frame++;
+    apply_loaded(upload_budget_bytes);
+
+    resident_bytes = 0;
+    std::vector<std::pair<std::shared_ptr<Texture>, StreamedTexture *>> entries;
+    for (auto it = textures.begin(); it != textures.end();) {
+        auto texture = it->second.texture.lock();
+        if (!texture) {
+            it = textures.erase(it);
+            continue;
+        }
+
+        StreamedTexture &entry = it->second;
+        const float pixels = texture->take_requested_resolution();
+        if (pixels > 0.0f) {
+            entry.last_used_frame = frame - 1;
+            entry.wanted_level = get_wanted_level(entry, pixels);
+        }
+
+        resident_bytes += texture->get_gpu_bytes() + entry.pending_bytes;
+        entries.push_back({texture, &entry});
+        ++it;
+    }
+
+    // Over budget: least recently drawn first. Textures that were not drawn
+    // last frame fall back to their coarse tail, the rest only shed mips
+    // finer than they currently want.
+    if (resident_bytes > vram_budget_bytes) {
+        std::sort(entries.begin(), entries.end(), [](const auto &a, const auto &b) {
+            return a.second->last_used_frame < b.second->last_used_frame;
+        });
+
+        for (auto &[texture, entry] : entries) {
+            if (resident_bytes <= vram_budget_bytes) break;
+            if (entry->in_flight) continue;
+
+            const int resident = texture->get_resident_level();
+            const int target = entry->last_used_frame + 1 < frame ? entry->coarsest_level : entry->wanted_level;
+            if (target <= resident) continue;
+
+            resident_bytes -= get_mip_chain_size(entry->format, entry->width, entry->height, resident, target);
+            request_levels(texture.get(), *entry, target, -1, true);
+        }
+    }
+
+    // Bring in finer mips for textures drawn last frame, as far as the budget allows.
+    for (auto &[texture, entry] : entries) {
+        if (entry->in_flight || entry->last_used_frame + 1 < frame) continue;
+
+        const int resident = texture->get_resident_level();
+        if (entry->wanted_level >= resident) continue;
+
+        const size_t cost = get_mip_chain_size(entry->format, entry->width, entry->height, entry->wanted_level, resident);
+        if (resident_bytes + cost > vram_budget_bytes) continue;
+
+        resident_bytes += cost;
+        entry->pending_bytes = cost;
+        request_levels(texture.get(), *entry, entry->wanted_level, resident, false);
+    }
+}
@@ -0,0 +1,136 @@
+#include "thread_pool.hpp"
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+namespace {
+    thread_local ThreadPool *current_pool = nullptr;
+
+    // Shared with the helper tasks, which may only start after parallel_for
+    // has returned; by then every range is taken and they touch nothing else.
+    struct ParallelFor {
+        const std::function<void(size_t, size_t)> *body;
+        size_t count;
+        size_t chunk_size;
+        size_t chunk_count;
+        std::atomic<size_t> next_chunk{0};
+
+        std::mutex mutex;
+        std::condition_variable finished;
+        size_t finished_count = 0;
+        std::exception_ptr error;
+
+        void run_chunks() {
+            while (true) {
+                const size_t chunk = next_chunk.fetch_add(1);
+                if (chunk >= chunk_count) return;
+
+                const size_t begin = chunk * chunk_size;
+                try {
+                    (*body)(begin, std::min(begin + chunk_size, count));
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!error) error = std::current_exception();
+                }
+
+                std::lock_guard<std::mutex> lock(mutex);
+                if (++finished_count == chunk_count) finished.notify_all();
+            }
+        }
+    };
+}
+
+ThreadPool::ThreadPool(size_t thread_count) {
+    if (thread_count == 0) thread_count = 1;
+
+    workers.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers.emplace_back(&ThreadPool::worker_loop, this);
+    }
+}
+
+// Queued tasks that have not started yet are dropped.
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+
+    for (auto &worker : workers) {
+        if (worker.joinable()) worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push(std::move(task));
+    }
+    condition.notify_one();
+}
+
+size_t ThreadPool::default_thread_count() {
+    const unsigned int hardware_threads = std::thread::hardware_concurrency();
+    return hardware_threads > 1 ? hardware_threads - 1 : 1;
+}
+
+ThreadPool *ThreadPool::get_current() {
+    return current_pool;
+}
+
+void ThreadPool::worker_loop() {
+    current_pool = this;
+    Profiler::set_thread_name("worker");
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (stopping) return;
+
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+
+        task();
+    }
+}
+
+void parallel_for(ThreadPool &pool, size_t count, const std::function<void(size_t begin, size_t end)> &body, size_t min_batch) {
+    if (count == 0) return;
+    if (min_batch == 0) min_batch = 1;
+
+    const size_t max_chunks = (count + min_batch - 1) / min_batch;
+    const size_t wanted_chunks = std::min(pool.get_thread_count() + 1, max_chunks);
+    if (wanted_chunks <= 1) {
+        body(0, count);
+        return;
+    }
+
+    auto state = std::make_shared<ParallelFor>();
+    state->body = &body;
+    state->count = count;
+    state->chunk_size = (count + wanted_chunks - 1) / wanted_chunks;
+    state->chunk_count = (count + state->chunk_size - 1) / state->chunk_size;
+
+    for (size_t i = 0; i + 1 < state->chunk_count; ++i) {
+        pool.submit([state] { state->run_chunks(); });
+    }
+    state->run_chunks();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&] { return state->finished_count == state->chunk_count; });
+    if (state->error) std::rethrow_exception(state->error);
+}
+
+void parallel_for(size_t count, const std::function<void(size_t begin, size_t end)> &body, size_t min_batch) {
+    if (ThreadPool *pool = ThreadPool::get_current()) {
+        parallel_for(*pool, count, body, min_batch);
+    } else if (count > 0) {
+        body(0, count);
+    }
+}
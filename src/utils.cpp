@@ -29,4 +29,14 @@ std::string read_file(const std::string &file_path) {
     std::stringstream buffer;
     buffer << file.rdbuf();
     return buffer.str();
-}
\ No newline at end of file
+}
+
+uint64_t hash_bytes(const void *data, size_t size, uint64_t seed) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
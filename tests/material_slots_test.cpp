@@ -0,0 +1,88 @@
+#include "parameter_block.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const char *what) {
+        if (condition) return;
+        std::cerr << "FAILED: " << what << "\n";
+        failures++;
+    }
+
+    // Built by hand instead of reflected from a linked program, so no GL
+    // context is needed: two 16-byte slots per window.
+    std::shared_ptr<const ParameterLayout> make_layout() {
+        auto layout = std::make_shared<ParameterLayout>();
+        layout->parameters = {{"base_color", GL_FLOAT_VEC3, 0}, {"smoothness", GL_FLOAT, 12}};
+        layout->size = 16;
+        layout->slot_count = 2;
+        return layout;
+    }
+
+    float get_float(const ParameterBlock &block, uint32_t slot, const std::string &name) {
+        float value = 0.0f;
+        std::memcpy(&value, block.get(slot, *block.get_layout().find(name)), sizeof(value));
+        return value;
+    }
+
+    void set_float(ParameterBlock &block, uint32_t slot, const std::string &name, float value) {
+        block.set(slot, *block.get_layout().find(name), &value);
+    }
+}
+
+int main() {
+    ParameterBlock block;
+    block.set_layout(make_layout(), 256);
+
+    // A block without instances still owns slot 0.
+    set_float(block, 0, "smoothness", 0.25f);
+    check(get_float(block, 0, "smoothness") == 0.25f, "material keeps its own value");
+
+    const uint32_t instance = block.allocate_slot();
+    check(instance == 1, "first instance gets slot 1");
+    check(get_float(block, instance, "smoothness") == 0.25f, "instance starts with the parent's value");
+
+    set_float(block, instance, "smoothness", 0.75f);
+    check(get_float(block, 0, "smoothness") == 0.25f, "override leaves the parent's value");
+    check(get_float(block, instance, "smoothness") == 0.75f, "instance keeps its override");
+
+    set_float(block, 0, "smoothness", 0.5f);
+    check(get_float(block, 0, "smoothness") == 0.5f, "parent takes the new value");
+    check(get_float(block, instance, "smoothness") == 0.75f, "overridden instance ignores the parent change");
+
+    // The third slot starts a new window at the next aligned offset.
+    const uint32_t next_window = block.allocate_slot();
+    check(block.get_window(next_window) == 1 && block.get_window_index(next_window) == 0, "third slot opens window 1");
+    check(block.get_slot_offset(next_window) == 256, "windows start on the alignment");
+    check(get_float(block, next_window, "smoothness") == 0.5f, "new window starts with the parent's value");
+
+    // Only what changed since the last upload is dirty.
+    block.clear_dirty();
+    set_float(block, instance, "smoothness", 1.0f);
+    check(block.get_dirty_begin() == 16 + 12 && block.get_dirty_end() == 16 + 16, "instance write dirties only its bytes");
+
+    // A new layout (another variant) keeps values and overrides by name.
+    auto reordered = std::make_shared<ParameterLayout>();
+    reordered->parameters = {{"smoothness", GL_FLOAT, 0}, {"base_color", GL_FLOAT_VEC3, 16}};
+    reordered->size = 32;
+    reordered->slot_count = 2;
+    block.set_layout(reordered, 256);
+    check(get_float(block, instance, "smoothness") == 1.0f, "override survives a layout change");
+    set_float(block, 0, "smoothness", 0.625f);
+    check(get_float(block, instance, "smoothness") == 1.0f, "instance still overrides after a layout change");
+
+    block.reset(instance, *block.get_layout().find("smoothness"));
+    check(get_float(block, instance, "smoothness") == 0.625f, "reset instance follows the parent again");
+
+    // The released slot is reused; slot 0 never is.
+    block.release_slot(instance);
+    check(block.allocate_slot() == instance, "released slot is reused");
+
+    if (failures) return EXIT_FAILURE;
+    std::cout << "material_slots_test passed\n";
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,303 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "asset_pack.hpp"
+#include "mesh_data.hpp"
+#include "profiler.hpp"
+#include "texture_compression.hpp"
+#include "thread_pool.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// asset_cooker [--out <dir>] [--pack <file.pak>] [--compress] [--force] [--trace <file.json>] <file or directory>...
+//
+// Converts source assets into what the engine loads at runtime, in parallel:
+// images to block-compressed .dds, models to .mesh. Outputs go to
+// <dir>/<source path><extension>, which is where AssetManager::get_cooked_path
+// looks when <dir> matches config.cooked_asset_dir. An output is only rebuilt
+// when the hash of its source bytes and cook settings changed since the last
+// run (or with --force). With --pack, the outputs and every other file given
+// (shaders and the like) are also written into an AssetPack. --trace writes
+// the profiler's zones for the run as a Chrome trace.
+
+namespace fs = std::filesystem;
+
+namespace {
+    // Bump when a cooked format or the cook settings change meaning, so old
+    // outputs are not taken as up to date.
+    constexpr uint64_t cooker_version = 1;
+    constexpr const char *manifest_name = "cook_manifest.txt";
+
+    enum class CookKind { Texture, Mesh, Raw };
+
+    struct CookJob {
+        std::string source_path;
+        std::string output_path; // empty for Raw
+        CookKind kind = CookKind::Raw;
+        TextureRole role = TextureRole::BaseMap;
+        bool srgb = false;
+
+        uint64_t hash = 0;
+        bool cooked = false;
+        bool success = false;
+    };
+
+    std::string lowercase(std::string text) {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return text;
+    }
+
+    CookKind get_kind(const fs::path &path) {
+        const std::string extension = lowercase(path.extension().string());
+        if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp") {
+            return CookKind::Texture;
+        }
+        if (extension == ".obj" || extension == ".fbx" || extension == ".gltf" || extension == ".glb" || extension == ".dae") {
+            return CookKind::Mesh;
+        }
+        return CookKind::Raw;
+    }
+
+    // Textures are named after their use (brick_normal.png, brick_mask.png);
+    // anything else is a color map.
+    void set_texture_role(CookJob &job) {
+        const std::string name = lowercase(fs::path(job.source_path).stem().string());
+        if (name.find("normal") != std::string::npos) {
+            job.role = TextureRole::NormalMap;
+        } else if (name.find("metallic") != std::string::npos || name.find("roughness") != std::string::npos ||
+                   name.find("occlusion") != std::string::npos || name.find("mask") != std::string::npos) {
+            job.role = TextureRole::Mask;
+        } else {
+            job.role = TextureRole::BaseMap;
+            job.srgb = true;
+        }
+    }
+
+    bool read_bytes(const std::string &path, std::vector<uint8_t> &bytes) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) return false;
+        bytes.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        return bool(file);
+    }
+
+    // Covers the source bytes and everything that changes the output for them.
+    // Models that reference other files (.mtl, .bin) are only hashed by the
+    // model file itself; use --force after editing those.
+    bool hash_job(const CookJob &job, uint64_t &hash) {
+        std::vector<uint8_t> bytes;
+        if (!read_bytes(job.source_path, bytes)) return false;
+
+        const uint64_t settings[] = {
+            cooker_version,
+            static_cast<uint64_t>(job.kind),
+            static_cast<uint64_t>(job.role),
+            static_cast<uint64_t>(job.srgb)
+        };
+        hash = hash_bytes(settings, sizeof(settings));
+        hash = hash_bytes(bytes.data(), bytes.size(), hash);
+        return true;
+    }
+
+    // One "<hash> <output path>" per line.
+    std::unordered_map<std::string, uint64_t> read_manifest(const fs::path &path) {
+        std::unordered_map<std::string, uint64_t> manifest;
+        std::ifstream file(path);
+        std::string output_path;
+        uint64_t hash;
+        while (file >> std::hex >> hash && std::getline(file >> std::ws, output_path)) {
+            manifest[output_path] = hash;
+        }
+        return manifest;
+    }
+
+    bool write_manifest(const fs::path &path, const std::unordered_map<std::string, uint64_t> &manifest) {
+        std::ofstream file(path, std::ios::trunc);
+        if (!file) {
+            std::cerr << "asset_cooker: failed to write " << path.generic_string() << "\n";
+            return false;
+        }
+        for (const auto &[output_path, hash] : manifest) {
+            file << std::hex << hash << " " << output_path << "\n";
+        }
+        return bool(file);
+    }
+
+    bool cook(CookJob &job) {
+        std::error_code error;
+        fs::create_directories(fs::path(job.output_path).parent_path(), error);
+
+        if (job.kind == CookKind::Texture) {
+            return cook_texture(job.source_path, job.output_path, job.role, job.srgb);
+        }
+
+        // The same import the engine falls back to when no cooked mesh exists.
+        MeshData mesh;
+        return import_mesh(job.source_path, mesh) && write_cooked_mesh(job.output_path, mesh);
+    }
+
+    bool is_under(const fs::path &path, const fs::path &directory) {
+        const fs::path relative = path.lexically_normal().lexically_relative(directory.lexically_normal());
+        return !relative.empty() && *relative.begin() != "..";
+    }
+}
+
+int main(int argc, char **argv) {
+    fs::path output_dir = "cooked";
+    std::string pack_path;
+    std::string trace_path;
+    bool compress = false;
+    bool force = false;
+    std::vector<fs::path> inputs;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc) {
+            output_dir = argv[++i];
+        } else if (arg == "--pack" && i + 1 < argc) {
+            pack_path = argv[++i];
+        } else if (arg == "--trace" && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (arg == "--compress") {
+            compress = true;
+        } else if (arg == "--force") {
+            force = true;
+        } else if (!arg.empty() && arg[0] == '-') {
+            std::cerr << "asset_cooker: unknown option " << arg << "\n";
+            return EXIT_FAILURE;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+
+    if (inputs.empty()) {
+        std::cerr << "usage: asset_cooker [--out <dir>] [--pack <file.pak>] [--compress] [--force] [--trace <file.json>] <file or directory>...\n";
+        return EXIT_FAILURE;
+    }
+
+    // Paths are kept as given (relative to where the engine runs), since that
+    // is how the engine will ask for them.
+    std::vector<CookJob> jobs;
+    std::unordered_set<std::string> seen;
+    auto add_job = [&](const fs::path &path) {
+        if (is_under(path, output_dir)) return;
+        const std::string source_path = path.generic_string();
+        if (!seen.insert(source_path).second) return;
+
+        CookJob job;
+        job.source_path = source_path;
+        job.kind = get_kind(path);
+        if (job.kind == CookKind::Texture) {
+            set_texture_role(job);
+            job.output_path = (output_dir / (source_path + ".dds")).generic_string();
+        } else if (job.kind == CookKind::Mesh) {
+            job.output_path = (output_dir / (source_path + ".mesh")).generic_string();
+        }
+        jobs.push_back(std::move(job));
+    };
+
+    bool success = true;
+    for (const fs::path &input : inputs) {
+        std::error_code error;
+        if (fs::is_directory(input, error)) {
+            for (const auto &entry : fs::recursive_directory_iterator(input, error)) {
+                if (entry.is_regular_file()) add_job(entry.path());
+            }
+        } else if (fs::is_regular_file(input, error)) {
+            add_job(input);
+        } else {
+            std::cerr << "asset_cooker: " << input.generic_string() << " not found\n";
+            success = false;
+        }
+    }
+    // Deterministic order for the log and the pack.
+    std::sort(jobs.begin(), jobs.end(), [](const CookJob &a, const CookJob &b) { return a.source_path < b.source_path; });
+
+    const fs::path manifest_path = output_dir / manifest_name;
+    std::unordered_map<std::string, uint64_t> manifest = force ? std::unordered_map<std::string, uint64_t>() : read_manifest(manifest_path);
+
+    // Jobs are spread over the pool; cook_texture and import_mesh split their
+    // own work further with parallel_for on the same pool.
+    ThreadPool pool;
+    std::mutex log_mutex;
+    parallel_for(pool, jobs.size(), [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            CookJob &job = jobs[i];
+            if (job.kind == CookKind::Raw) {
+                job.success = true;
+                continue;
+            }
+
+            if (!hash_job(job, job.hash)) {
+                std::lock_guard<std::mutex> lock(log_mutex);
+                std::cerr << "asset_cooker: failed to read " << job.source_path << "\n";
+                continue;
+            }
+
+            auto it = manifest.find(job.output_path);
+            std::error_code error;
+            if (it != manifest.end() && it->second == job.hash && fs::exists(job.output_path, error)) {
+                job.success = true;
+                continue;
+            }
+
+            job.cooked = true;
+            {
+                PROFILE_SCOPE("cook");
+                job.success = cook(job);
+            }
+
+            std::lock_guard<std::mutex> lock(log_mutex);
+            if (job.success) {
+                std::cout << "cooked " << job.source_path << " -> " << job.output_path << "\n";
+            } else {
+                std::cerr << "asset_cooker: failed to cook " << job.source_path << "\n";
+            }
+        }
+    });
+
+    size_t cooked = 0, skipped = 0, failed = 0;
+    for (const CookJob &job : jobs) {
+        if (job.kind == CookKind::Raw) continue;
+        if (!job.success) {
+            // Forget the old hash so the next run retries it.
+            manifest.erase(job.output_path);
+            failed++;
+            continue;
+        }
+        manifest[job.output_path] = job.hash;
+        if (job.cooked) cooked++;
+        else skipped++;
+    }
+
+    std::error_code error;
+    fs::create_directories(output_dir, error);
+    success &= write_manifest(manifest_path, manifest);
+    std::cout << cooked << " cooked, " << skipped << " up to date, " << failed << " failed\n";
+
+    if (!pack_path.empty()) {
+        std::vector<AssetPackInput> pack_inputs;
+        for (const CookJob &job : jobs) {
+            if (!job.success) continue;
+            if (job.kind == CookKind::Raw) pack_inputs.push_back({job.source_path, job.source_path});
+            else pack_inputs.push_back({job.output_path, job.output_path});
+        }
+        success &= write_asset_pack(pack_path, pack_inputs, compress);
+    }
+
+    if (!trace_path.empty()) success &= Profiler::write_chrome_trace(trace_path);
+
+    return success && failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}